@@ -0,0 +1,145 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Display changes collected for a batch: cells to redraw, and rows
+   and columns whose marks have changed, each as a bit set, with the
+   cells also bounded by a rectangle.  Nothing is reported until the
+   batch is flushed. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#define WORDS(N) (((N) + nonogram_CHANGEBITS - 1) / nonogram_CHANGEBITS)
+#define BIT(X) ((nonogram_changeword) 1 << ((X) % nonogram_CHANGEBITS))
+
+struct nonogram_batcher {
+  struct nonogram_batch batch;
+  nonogram_changeword *cells, *rows, *cols;
+  size_t width, height, held;
+  int pending;
+};
+
+void nonogram_freebatcher(struct nonogram_batcher *b)
+{
+  if (!b) return;
+  free(b->cells);
+  free(b);
+}
+
+struct nonogram_batcher *nonogram_makebatcher(struct nonogram_batcher *b,
+                                              const nonogram_solver *c)
+{
+  if (!b) {
+    b = malloc(sizeof *b);
+    if (!b) return NULL;
+    b->cells = NULL;
+  }
+  b->width = c->puzzle->width;
+  b->height = c->puzzle->height;
+  b->batch.cellwords = WORDS(b->width);
+
+  /* one block for all three sets */
+  const size_t words = b->batch.cellwords * b->height +
+    WORDS(b->height) + WORDS(b->width);
+  b->cells = nonogram_reserve(b->cells, &b->held, words * sizeof *b->cells);
+  if (!b->cells) {
+    free(b);
+    return NULL;
+  }
+  memset(b->cells, 0, words * sizeof *b->cells);
+  b->rows = b->cells + b->batch.cellwords * b->height;
+  b->cols = b->rows + WORDS(b->height);
+  b->batch.cells = b->cells;
+  b->batch.rows = b->rows;
+  b->batch.cols = b->cols;
+  b->batch.area.min.x = b->batch.area.min.y = 0;
+  b->batch.area.max.x = b->batch.area.max.y = 0;
+  b->pending = false;
+  return b;
+}
+
+/* Set bits [from, to) of a set. */
+static void setbits(nonogram_changeword *s, size_t from, size_t to)
+{
+  for ( ; from < to && from % nonogram_CHANGEBITS != 0; from++)
+    s[from / nonogram_CHANGEBITS] |= BIT(from);
+  for ( ; to - from >= nonogram_CHANGEBITS; from += nonogram_CHANGEBITS)
+    s[from / nonogram_CHANGEBITS] = ~(nonogram_changeword) 0;
+  for ( ; from < to; from++)
+    s[from / nonogram_CHANGEBITS] |= BIT(from);
+}
+
+void nonogram_batcharea(struct nonogram_batcher *b,
+                        const struct nonogram_rect *r)
+{
+  struct nonogram_rect *a = &b->batch.area;
+
+  if (r->min.x >= r->max.x || r->min.y >= r->max.y)
+    return;
+  for (size_t y = r->min.y; y < r->max.y; y++)
+    setbits(b->cells + y * b->batch.cellwords, r->min.x, r->max.x);
+
+  if (a->min.x >= a->max.x) {
+    *a = *r;
+  } else {
+    if (r->min.x < a->min.x) a->min.x = r->min.x;
+    if (r->min.y < a->min.y) a->min.y = r->min.y;
+    if (r->max.x > a->max.x) a->max.x = r->max.x;
+    if (r->max.y > a->max.y) a->max.y = r->max.y;
+  }
+  b->pending = true;
+}
+
+void nonogram_batchmarks(struct nonogram_batcher *b, int rows,
+                         size_t from, size_t to)
+{
+  if (from >= to)
+    return;
+  setbits(rows ? b->rows : b->cols, from, to);
+  b->pending = true;
+}
+
+int nonogram_flushdisplay(nonogram_solver *c)
+{
+  struct nonogram_batcher *b = c->batcher;
+
+  if (!c->puzzle) return -1;
+  c->batched = 0;
+  if (!b || !b->pending)
+    return 0;
+  (*c->display->flush)(c->display_data, &b->batch);
+
+  /* Only the rows in the area can have cells set. */
+  struct nonogram_rect *a = &b->batch.area;
+  if (a->min.y < a->max.y)
+    memset(b->cells + a->min.y * b->batch.cellwords, 0,
+           (a->max.y - a->min.y) * b->batch.cellwords * sizeof *b->cells);
+  memset(b->rows, 0, WORDS(b->height) * sizeof *b->rows);
+  memset(b->cols, 0, WORDS(b->width) * sizeof *b->cols);
+  a->min.x = a->min.y = a->max.x = a->max.y = 0;
+  b->pending = false;
+  return 0;
+}
@@ -0,0 +1,65 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Sets of cells changed since each line was last solved, so that a
+   line solver can tell what it is being asked again about. */
+
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#define WORD(X) ((X) / nonogram_CHANGEBITS)
+#define BIT(X) ((nonogram_changeword) 1 << ((X) % nonogram_CHANGEBITS))
+
+void nonogram_touchcell(nonogram_solver *c, size_t x, size_t y)
+{
+  c->rowchanged[y * c->rowwords + WORD(x)] |= BIT(x);
+  c->colchanged[x * c->colwords + WORD(y)] |= BIT(y);
+}
+
+void nonogram_toucharea(nonogram_solver *c, const struct nonogram_rect *r)
+{
+  for (size_t y = r->min.y; y < r->max.y; y++)
+    for (size_t x = r->min.x; x < r->max.x; x++)
+      nonogram_touchcell(c, x, y);
+}
+
+void nonogram_touchall(nonogram_solver *c)
+{
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++)
+      nonogram_touchcell(c, x, y);
+}
+
+void nonogram_untouchline(nonogram_solver *c, int on_row, size_t lineno)
+{
+  if (on_row)
+    memset(c->rowchanged + lineno * c->rowwords, 0,
+           c->rowwords * sizeof *c->rowchanged);
+  else
+    memset(c->colchanged + lineno * c->colwords, 0,
+           c->colwords * sizeof *c->colchanged);
+}
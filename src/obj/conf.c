@@ -24,6 +24,7 @@
 #include <stdlib.h>
 
 #include "nonogram.h"
+#include "internal.h"
 
 int nonogram_setlinesolver(nonogram_solver *c,
                            nonogram_level lvl, const char *n,
@@ -66,6 +67,16 @@ int nonogram_setclient(nonogram_solver *c,
   return 0;
 }
 
+int nonogram_setguesser(nonogram_solver *c,
+                        const struct nonogram_guesser *guesser,
+                        void *guesser_data)
+{
+  if (c->puzzle) return -1;
+  c->guesser_data = guesser_data;
+  c->guesser = guesser ? guesser : &nonogram_firstguesser;
+  return 0;
+}
+
 int nonogram_setdisplay(nonogram_solver *c,
                         const struct nonogram_display *display,
                         void *display_data)
@@ -76,6 +87,97 @@ int nonogram_setdisplay(nonogram_solver *c,
   return 0;
 }
 
+int nonogram_setdisplaybatch(nonogram_solver *c, unsigned lines)
+{
+  if (c->puzzle) return -1;
+  c->batchlines = lines;
+  return 0;
+}
+
+int nonogram_setlinecache(nonogram_solver *c, nonogram_linecache *lc)
+{
+  if (c->puzzle) return -1;
+  c->linecache = lc;
+  return 0;
+}
+
+int nonogram_settrace(nonogram_solver *c, nonogram_trace *t)
+{
+  if (c->puzzle) return -1;
+  c->trace = t;
+  return 0;
+}
+
+int nonogram_setthreads(nonogram_solver *c, unsigned threads)
+{
+  if (c->puzzle) return -1;
+  if (threads > 1) {
+    struct nonogram_pool *pool = nonogram_makepool(1);
+    if (!pool) return -1;
+    nonogram_freepool(pool);
+  }
+  c->threads = threads;
+  return 0;
+}
+
+int nonogram_setpackstack(nonogram_solver *c, int packed)
+{
+  if (c->puzzle) return -1;
+  c->packstack = !!packed;
+  return 0;
+}
+
+int nonogram_settrail(nonogram_solver *c, int on)
+{
+  if (c->puzzle) return -1;
+  c->usetrail = !!on;
+  return 0;
+}
+
+int nonogram_setprobing(nonogram_solver *c, unsigned lines)
+{
+  if (c->puzzle) return -1;
+  c->probing = lines;
+  return 0;
+}
+
+int nonogram_setlearning(nonogram_solver *c, unsigned nogoods)
+{
+  if (c->puzzle) return -1;
+  c->learning = nogoods;
+  return 0;
+}
+
+int nonogram_setsat(nonogram_solver *c, int on)
+{
+  if (c->puzzle) return -1;
+  c->usesat = !!on;
+  return 0;
+}
+
+int nonogram_setpushmemo(nonogram_solver *c, int on)
+{
+  if (c->puzzle) return -1;
+  c->pushmemo = !!on;
+  return 0;
+}
+
+int nonogram_copyconf(nonogram_solver *to, const nonogram_solver *from)
+{
+  if (nonogram_setlinesolvers(to, from->levels) < 0) return -1;
+  for (nonogram_level lvl = 1; lvl <= from->levels; lvl++)
+    nonogram_setlinesolver(to, lvl, from->linesolver[lvl - 1].name,
+                           from->linesolver[lvl - 1].suite,
+                           from->linesolver[lvl - 1].context);
+  to->first = from->first;
+  to->probing = from->probing;
+  to->pushmemo = from->pushmemo;
+  to->linecache = from->linecache;
+  to->guesser = from->guesser;
+  to->guesser_data = from->guesser_data;
+  return 0;
+}
+
 int nonogram_setlog(nonogram_solver *c, FILE *logfile, int indent, int lvl)
 {
   if (c->puzzle) return -1;
@@ -153,6 +255,22 @@ int nonogram_setalgo(nonogram_solver *c, int i)
     nonogram_setlinesolver(c, 1, "fcomp", &nonogram_fcompsuite, 0);
     nonogram_setlinesolver(c, 2, "fast", &nonogram_fastsuite, 0);
     break;
+
+  case nonogram_ABITS:
+    nonogram_setlinesolvers(c, 1);
+    nonogram_setlinesolver(c, 1, "bits", &nonogram_bitsuite, 0);
+    break;
+
+  case nonogram_ADP:
+    nonogram_setlinesolvers(c, 1);
+    nonogram_setlinesolver(c, 1, "dp", &nonogram_dpsuite, 0);
+    break;
+
+  case nonogram_AFASTDP:
+    nonogram_setlinesolvers(c, 2);
+    nonogram_setlinesolver(c, 1, "dp", &nonogram_dpsuite, 0);
+    nonogram_setlinesolver(c, 2, "fast", &nonogram_fastsuite, 0);
+    break;
   }
   return 0;
 }
@@ -0,0 +1,234 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* A file of many puzzles, one after another, mapped into memory where
+   possible, and otherwise read in whole.  The start of each puzzle is
+   found in one pass, without storing any of them, and each can then
+   be parsed directly from the file's contents when asked for. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+/* Define nonogram_MMAP as 0 to read files in with stdio instead. */
+#ifndef nonogram_MMAP
+#if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+#define nonogram_MMAP 1
+#else
+#define nonogram_MMAP 0
+#endif
+#endif
+
+#if nonogram_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct nonogram_corpus {
+  const char *base;
+  size_t len;
+
+  /* how 'base' was obtained, and so how to release it */
+  enum { BORROWED, MAPPED, ALLOCATED } how;
+
+  /* where each puzzle starts, and where the last one ends */
+  size_t *start, count, cap, end;
+};
+
+static int index_corpus(nonogram_corpus *c)
+{
+  const char *s = c->base, *const e = c->base + c->len;
+
+  for (;;) {
+    const size_t at = s - c->base;
+    if (nonogram_skippuzzle(&s, e) < 0)
+      break;
+    if (c->count == c->cap) {
+      size_t cap = c->cap ? c->cap * 2 : 64;
+      size_t *start = realloc(c->start, cap * sizeof *start);
+      if (!start)
+        return -1;
+      c->start = start;
+      c->cap = cap;
+    }
+    c->start[c->count++] = at;
+    c->end = s - c->base;
+  }
+  return 0;
+}
+
+static nonogram_corpus *newcorpus(void)
+{
+  nonogram_corpus *c = malloc(sizeof *c);
+  if (!c) return NULL;
+  c->base = NULL;
+  c->len = 0;
+  c->how = BORROWED;
+  c->start = NULL;
+  c->count = c->cap = c->end = 0;
+  return c;
+}
+
+nonogram_corpus *nonogram_makecorpus(const char *s, const char *e)
+{
+  nonogram_corpus *c = newcorpus();
+  if (!c) return NULL;
+  c->base = s;
+  c->len = e - s;
+  if (index_corpus(c) < 0) {
+    nonogram_closecorpus(c);
+    return NULL;
+  }
+  return c;
+}
+
+#if nonogram_MMAP
+static int mapfile(nonogram_corpus *c, const char *filename)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return -1;
+  }
+
+  /* An empty file can't be mapped, but has nothing to map anyway. */
+  if (st.st_size == 0) {
+    c->base = "";
+  } else {
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+      close(fd);
+      return -1;
+    }
+    c->base = base;
+    c->len = st.st_size;
+    c->how = MAPPED;
+  }
+  close(fd);
+  return 0;
+}
+#endif
+
+static int readfile(nonogram_corpus *c, const char *filename)
+{
+  FILE *fp = fopen(filename, "rb");
+  if (!fp)
+    return -1;
+
+  char *buf = NULL;
+  size_t len = 0, cap = 0, got;
+  do {
+    if (cap - len < 4096) {
+      cap = cap ? cap * 2 : 65536;
+      char *tmp = realloc(buf, cap);
+      if (!tmp) {
+        free(buf);
+        fclose(fp);
+        return -1;
+      }
+      buf = tmp;
+    }
+    got = fread(buf + len, 1, cap - len, fp);
+    len += got;
+  } while (got > 0);
+
+  int rc = ferror(fp) ? -1 : 0;
+  fclose(fp);
+  if (rc < 0) {
+    free(buf);
+    return -1;
+  }
+  c->base = buf;
+  c->len = len;
+  c->how = ALLOCATED;
+  return 0;
+}
+
+nonogram_corpus *nonogram_opencorpus(const char *filename)
+{
+  nonogram_corpus *c = newcorpus();
+  if (!c) return NULL;
+
+  int rc = -1;
+#if nonogram_MMAP
+  rc = mapfile(c, filename);
+#endif
+  if (rc < 0)
+    rc = readfile(c, filename);
+  if (rc < 0 || index_corpus(c) < 0) {
+    nonogram_closecorpus(c);
+    return NULL;
+  }
+  return c;
+}
+
+void nonogram_closecorpus(nonogram_corpus *c)
+{
+  if (!c) return;
+  switch (c->how) {
+  case BORROWED:
+    break;
+  case MAPPED:
+#if nonogram_MMAP
+    munmap((void *) c->base, c->len);
+#endif
+    break;
+  case ALLOCATED:
+    free((void *) c->base);
+    break;
+  }
+  free(c->start);
+  free(c);
+}
+
+size_t nonogram_corpussize(const nonogram_corpus *c)
+{
+  return c->count;
+}
+
+size_t nonogram_corpusend(const nonogram_corpus *c)
+{
+  return c->end;
+}
+
+int nonogram_corpuspuzzle_ef(const nonogram_corpus *c, size_t i,
+                             nonogram_puzzle *p,
+                             nonogram_errorproc *ef, void *eh)
+{
+  if (i >= c->count)
+    return -1;
+  const char *s = c->base + c->start[i];
+  const char *e = c->base + (i + 1 < c->count ? c->start[i + 1] : c->end);
+  return nonogram_spscanpuzzle_ef(p, &s, e, ef, eh);
+}
@@ -0,0 +1,91 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Deadlines on a monotonic clock.  Reading the clock costs far more
+   than a typical step, so it is read only every so many tests.  The
+   interval is worked out from how long the last one took, so that
+   the clock is read at least every 'slack' nanoseconds, and not long
+   after the deadline, as long as steps take about as long as they
+   have been taking. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+
+#include "nonogram.h"
+
+/* The interval grows by no more than this factor at a time, in case
+   the last one was unusually quick. */
+#define GROWTH 2
+
+unsigned long long nonogram_monotime(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (unsigned long long) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+  /* Processor time will have to do. */
+  return (unsigned long long) ((double) clock() * 1e9 / CLOCKS_PER_SEC);
+}
+
+void nonogram_setdeadline(struct nonogram_deadline *d,
+                          unsigned long long when, unsigned long long slack)
+{
+  d->when = when;
+  d->slack = slack > 0 ? slack : 1;
+  d->last = nonogram_monotime();
+  d->every = d->left = 1;
+}
+
+int nonogram_testdeadline(void *vd)
+{
+  struct nonogram_deadline *d = vd;
+
+  /* Once expired, stay so without reading the clock again. */
+  if (d->left == 0)
+    return false;
+  if (--d->left > 0)
+    return true;
+
+  const unsigned long long now = nonogram_monotime();
+  if (now >= d->when)
+    return false;
+
+  /* Read again before the slack or the time left is used up. */
+  const unsigned long long spent = now - d->last;
+  unsigned long long aim = d->when - now;
+  if (aim > d->slack)
+    aim = d->slack;
+  unsigned long every;
+  if (spent == 0 || spent / d->every == 0) {
+    every = d->every * GROWTH;
+  } else {
+    const unsigned long long per = spent / d->every;
+    every = aim / per > d->every * GROWTH ? d->every * GROWTH : aim / per;
+  }
+  d->every = every > 0 ? every : 1;
+  d->left = d->every;
+  d->last = now;
+  return true;
+}
@@ -0,0 +1,251 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/*
+ * This algorithm deduces exactly what 'complete' deduces, but without
+ * enumerating every arrangement of blocks.  Instead, it works out
+ * which (cell, block) states are reachable from each end of the line,
+ * and a block placement or dot is possible only if it joins a state
+ * reachable from the start to one reachable from the end.
+ *
+ * A 'boundary' i (0 <= i <= len + 1) is the state of having decided
+ * cells [0, i), with cell i - 1 (if any) being a dot.  An imaginary
+ * dot is placed at cell len, so that the last block can also be
+ * followed by one.  fwd[i][j] is true if cells [0, i) can hold
+ * exactly blocks [0, j).  bwd[i][j] is true if cells [i, len] can
+ * hold exactly blocks [j, rules).  From boundary i holding j blocks,
+ * we can either place a dot at i, reaching (i + 1, j), or place block
+ * j at [i, i + rule[j]) followed by a dot, reaching (i + rule[j] + 1,
+ * j + 1).
+ *
+ * Each step computes one row of fwd (FORWARD) or bwd (BACKWARD), or
+ * records the dots and blocks that leave one boundary (MARK), so the
+ * cost is bounded by (len + 2) * (rules + 1) state checks, each
+ * taking constant time.  Counting the dots before each cell lets us
+ * check that a block covers no dot in constant time too, and solids
+ * are recorded as the start and end of each possible block, and
+ * accumulated in a final pass.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+static void prep(void *,
+                 const struct nonogram_lim *, struct nonogram_req *);
+static int init(void *, struct nonogram_ws *ws,
+                const struct nonogram_initargs *);
+static int step(void *, void *ws);
+
+const struct nonogram_linesuite nonogram_dpsuite = {
+  &prep,
+  &init,
+  &step,
+  0
+};
+
+typedef enum {
+  FORWARD,
+  BACKWARD,
+  MARK,
+} stepmode;
+
+struct work {
+  struct nonogram_initargs a;
+  size_t rules, row, i;
+  stepmode mode;
+
+  /* dots[x] is the number of dots in cells [0, x). */
+  nonogram_sizetype *dots;
+
+  /* cover[x] is the number of possible blocks starting at x, less
+     the number ending at x. */
+  ptrdiff_t *cover;
+
+  /* fwd and bwd follow this structure, each of (len + 2) rows of
+     (rules + 1) entries. */
+  unsigned char *fwd, *bwd;
+};
+
+#define LEN (a->linelen)
+#define RULES (c->rules)
+#define RULE(I) (a->rule[(I) * a->rulestep])
+#define CELL(X) (a->line[(X) * a->linestep])
+#define RESULT(X) (a->result[(X) * a->resultstep])
+#define FWD(I,J) (c->fwd[(I) * c->row + (J)])
+#define BWD(I,J) (c->bwd[(I) * c->row + (J)])
+
+/* Can cell x (including the imaginary one at len) be a dot? */
+#define CANDOT(X) ((X) == LEN || CELL(X) != nonogram_SOLID)
+
+/* Are there no dots in cells [s, e)? */
+#define NODOT(S,E) (c->dots[E] == c->dots[S])
+
+/* Can block j be placed at cell s, followed by a dot? */
+#define CANPLACE(S,J) \
+  ((S) + RULE(J) <= LEN && NODOT((S), (S) + RULE(J)) && \
+   CANDOT((S) + RULE(J)))
+
+static void prep(void *ct,
+                 const struct nonogram_lim *l, struct nonogram_req *r)
+{
+  UNUSED(ct);
+  r->byte = sizeof(struct work) + 2 * (l->maxline + 2) * (l->maxrule + 1);
+  r->ptrdiff = l->maxline + 2;
+  r->size = 0;
+  r->nonogram_size = l->maxline + 2;
+}
+
+static int init(void *ct, struct nonogram_ws *ws,
+                const struct nonogram_initargs *a)
+{
+  struct work *c = ws->byte;
+  size_t remunk = 0;
+
+  UNUSED(ct);
+
+  c->a = *a;
+  c->rules = a->rulelen;
+  if (c->rules == 1 && RULE(0) == 0)
+    c->rules = 0;
+  c->row = c->rules + 1;
+  c->dots = ws->nonogram_size;
+  c->cover = ws->ptrdiff;
+  c->fwd = (unsigned char *) (c + 1);
+  c->bwd = c->fwd + (LEN + 2) * c->row;
+
+  c->dots[0] = 0;
+  for (size_t x = 0; x < LEN; x++) {
+    remunk += (RESULT(x) = CELL(x)) == nonogram_BLANK;
+    c->dots[x + 1] = c->dots[x] + (CELL(x) == nonogram_DOT);
+    c->cover[x] = 0;
+  }
+  c->cover[LEN] = 0;
+
+  if (remunk == 0) {
+    *a->fits =
+      !nonogram_checkline(a->rule, a->rulelen, a->rulestep,
+                          a->line, a->linelen, a->linestep);
+    return false;
+  }
+
+  /* Only the empty prefix holds no blocks at the start. */
+  FWD(0, 0) = true;
+  for (size_t j = 1; j <= RULES; j++)
+    FWD(0, j) = false;
+
+  *a->fits = 0;
+  c->mode = FORWARD;
+  c->i = 1;
+  return true;
+}
+
+static int step(void *ct, void *ws)
+{
+  struct work *c = ws;
+  const struct nonogram_initargs *a = &c->a;
+  size_t i = c->i;
+
+  UNUSED(ct);
+
+  switch (c->mode) {
+  case FORWARD:
+    /* Boundary i is reached by a dot at i - 1, either following
+       another dot, or following a block. */
+    for (size_t j = 0; j <= RULES; j++) {
+      FWD(i, j) = false;
+      if (!CANDOT(i - 1))
+        continue;
+      if (FWD(i - 1, j)) {
+        FWD(i, j) = true;
+        continue;
+      }
+      if (j == 0)
+        continue;
+      size_t len = RULE(j - 1);
+      FWD(i, j) = i - 1 >= len && FWD(i - 1 - len, j - 1) &&
+        NODOT(i - 1 - len, i - 1);
+    }
+    if (i <= LEN) {
+      c->i++;
+      return true;
+    }
+
+    /* Can all the blocks be fitted in at all? */
+    if (!FWD(LEN + 1, RULES))
+      return false;
+
+    /* Only the empty suffix holds no blocks at the end. */
+    for (size_t j = 0; j < RULES; j++)
+      BWD(LEN + 1, j) = false;
+    BWD(LEN + 1, RULES) = true;
+    c->mode = BACKWARD;
+    c->i = LEN;
+    return true;
+
+  case BACKWARD:
+    for (size_t j = 0; j <= RULES; j++)
+      BWD(i, j) = (CANDOT(i) && BWD(i + 1, j)) ||
+        (j < RULES && CANPLACE(i, j) && BWD(i + RULE(j) + 1, j + 1));
+    if (i > 0) {
+      c->i--;
+      return true;
+    }
+    c->mode = MARK;
+    return true;
+
+  case MARK:
+    if (i < LEN) {
+      for (size_t j = 0; j <= RULES; j++) {
+        if (!FWD(i, j))
+          continue;
+        if (CELL(i) != nonogram_SOLID && BWD(i + 1, j))
+          RESULT(i) |= nonogram_DOT;
+        if (j < RULES && CANPLACE(i, j) && BWD(i + RULE(j) + 1, j + 1)) {
+          size_t end = i + RULE(j);
+          c->cover[i]++;
+          c->cover[end]--;
+          if (end < LEN)
+            RESULT(end) |= nonogram_DOT;
+        }
+      }
+      c->i++;
+      return true;
+    }
+
+    /* Accumulate the possible blocks to find the possible solids. */
+    {
+      ptrdiff_t covered = 0;
+      for (size_t x = 0; x < LEN; x++) {
+        covered += c->cover[x];
+        if (covered > 0)
+          RESULT(x) |= nonogram_SOLID;
+      }
+    }
+    *a->fits = 1;
+    return false;
+  }
+  return false;
+}
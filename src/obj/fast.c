@@ -48,7 +48,8 @@ static int solve(const nonogram_cell *line,
                  size_t rulelen, ptrdiff_t rulestep,
                  nonogram_cell *work, ptrdiff_t workstep,
                  nonogram_sizetype *lpos, nonogram_sizetype *rpos,
-                 ptrdiff_t *solid, FILE *log, int level, int indent)
+                 ptrdiff_t *solid, struct nonogram_pushmemo *memo,
+                 FILE *log, int level, int indent)
 {
   /* nonogram_size */
   size_t i, j, k;
@@ -66,8 +67,9 @@ static int solve(const nonogram_cell *line,
 
   if (rulelen == 1 && *rule == 0) rulelen = 0;
 
-  if (!nonogram_push(line, linelen, linestep, rule, rulelen, rulestep,
-                     lpos, 1, solid, log, level, indent))
+  if (!nonogram_pushmemo(memo, 0,
+                         line, linelen, linestep, rule, rulelen, rulestep,
+                         lpos, 1, solid, log, level, indent))
     return 0;
 
 #if nonogram_LOGLEVEL > 1
@@ -121,10 +123,10 @@ static int solve(const nonogram_cell *line,
   }
 #endif
 
-  if (!nonogram_push(rline, linelen, -linestep,
-                     rule + (rulelen - 1) * rulestep,
-                     rulelen, -rulestep, rpos + (rulelen - 1), -1, solid,
-                     log, level, indent))
+  if (!nonogram_pushmemo(memo, 1, rline, linelen, -linestep,
+                         rule + (rulelen - 1) * rulestep,
+                         rulelen, -rulestep, rpos + (rulelen - 1), -1, solid,
+                         log, level, indent))
     return 0;
 #if nonogram_LOGLEVEL > 1
   if (log && level > 0) {
@@ -197,18 +199,26 @@ static int solve(const nonogram_cell *line,
   return 1;  
 }
 
-static int init(void *ct, struct nonogram_ws *c,
-                const struct nonogram_initargs *a)
+static int resume(void *ct, struct nonogram_ws *c,
+                  const struct nonogram_initargs *a,
+                  const struct nonogram_linehist *h)
 {
   UNUSED(ct);
   *a->fits = solve(a->line, a->linelen, a->linestep,
                    a->rule, a->rulelen, a->rulestep,
                    a->result, a->resultstep,
                    c->nonogram_size, c->nonogram_size + a->rulelen,
-                   c->ptrdiff, a->log->file, a->log->level, a->log->indent);
+                   c->ptrdiff, h ? h->memo : NULL,
+                   a->log->file, a->log->level, a->log->indent);
   return false;
 }
 
+static int init(void *ct, struct nonogram_ws *c,
+                const struct nonogram_initargs *a)
+{
+  return resume(ct, c, a, NULL);
+}
+
 const struct nonogram_linesuite nonogram_fastsuite = {
-  &prep, &init, 0, 0
+  &prep, &init, 0, 0, &resume
 };
@@ -68,6 +68,7 @@
  **/
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <assert.h>
 
 #include "nonogram.h"
@@ -82,6 +83,17 @@ const struct nonogram_linesuite nonogram_fcompsuite = {
   &prep, &init, &step, 0
 };
 
+/* Lines short enough to fit in a machine word are solved in one go
+   by bit-parallel operations (see the end of this file).  Longer lines
+   fall back to the stepwise algorithm, so the same workspace and step
+   function are used. */
+static int bits_init(void *, struct nonogram_ws *ws,
+                     const struct nonogram_initargs *a);
+
+const struct nonogram_linesuite nonogram_bitsuite = {
+  &prep, &bits_init, &step, 0
+};
+
 /*
  * 'remunk' is initially the number of unknown cells.  Whenever a cell
  * in the result becomes 'BOTH', it is decremented.  If it ever
@@ -578,7 +590,9 @@ static int step_invalid(void *vp, void *ws)
     printf("Spilled over\n");
 
     // Restore everything back to where we diverged from a valid
-    // state.
+    // state.  Later blocks may have been pushed along before drawing
+    // brought us back to this one, so restore them too.
+    B = MAX - 1;
     ctxt->mode = RESTORING;
     return true;
   }
@@ -931,3 +945,223 @@ static int step_restoring(void *vp, void *ws)
   ctxt->mode = DRAWING;
   return true;
 }
+
+
+/**
+ * The bit-parallel solver represents a line of up to 64 cells as a
+ * pair of masks, one for known dots and one for known solids, with bit
+ * 'n' standing for cell 'n'.  Sets of block positions are held in the
+ * same form, so all positions of a block are considered at once.
+ *
+ * A forward pass finds, for each block, the starting positions that
+ * are consistent with the line to their left.  The lowest of these is
+ * the block's pushed-left position.  A backward pass then keeps only
+ * those which can also be completed to the right, the highest
+ * remaining being the pushed-right position.  What remains is the set
+ * of every position that the block takes in some solution of the line,
+ * so the overlap of these sets gives the same deductions as the
+ * stepwise algorithm above, without walking the line cell by cell.
+ **/
+
+typedef uint_least64_t lineset;
+
+#define LINESET_BITS 64
+#define BIT(X) ((lineset) 1 << (X))
+
+static lineset shl(lineset x, size_t n)
+{
+  return n >= LINESET_BITS ? 0 : x << n;
+}
+
+static lineset shr(lineset x, size_t n)
+{
+  return n >= LINESET_BITS ? 0 : x >> n;
+}
+
+// Extend each member of 'gen' upwards, one cell at a time, for as long
+// as the next cell is a member of 'pro'.
+static lineset fill_up(lineset gen, lineset pro)
+{
+  gen |= pro & (gen << 1);
+  pro &= pro << 1;
+  gen |= pro & (gen << 2);
+  pro &= pro << 2;
+  gen |= pro & (gen << 4);
+  pro &= pro << 4;
+  gen |= pro & (gen << 8);
+  pro &= pro << 8;
+  gen |= pro & (gen << 16);
+  pro &= pro << 16;
+  gen |= pro & (gen << 32);
+  return gen;
+}
+
+// Extend each member of 'gen' downwards, one cell at a time, for as
+// long as the next cell is a member of 'pro'.
+static lineset fill_down(lineset gen, lineset pro)
+{
+  gen |= pro & (gen >> 1);
+  pro &= pro >> 1;
+  gen |= pro & (gen >> 2);
+  pro &= pro >> 2;
+  gen |= pro & (gen >> 4);
+  pro &= pro >> 4;
+  gen |= pro & (gen >> 8);
+  pro &= pro >> 8;
+  gen |= pro & (gen >> 16);
+  pro &= pro >> 16;
+  gen |= pro & (gen >> 32);
+  return gen;
+}
+
+// Find the positions at which 'len' consecutive members of 'set'
+// begin.
+static lineset runs_of(lineset set, nonogram_sizetype len)
+{
+  nonogram_sizetype got = 1;
+  while (got * 2 <= len) {
+    set &= set >> got;
+    got *= 2;
+  }
+  if (got < len)
+    set &= set >> (len - got);
+  return set;
+}
+
+// Find the cells covered by a block of length 'len' starting at any of
+// 'starts'.
+static lineset cover(lineset starts, nonogram_sizetype len)
+{
+  nonogram_sizetype got = 1;
+  while (got * 2 <= len) {
+    starts |= starts << got;
+    got *= 2;
+  }
+  if (got < len)
+    starts |= starts << (len - got);
+  return starts;
+}
+
+// Solve the line completely, writing the positions that each block can
+// start at into 'valid'.  Return false if the line is inconsistent.
+static int bits_solve(const struct nonogram_initargs *a, lineset *valid,
+                      lineset *maydot, lineset *maysolid)
+{
+  const lineset all = LEN == LINESET_BITS ? ~(lineset) 0 : BIT(LEN) - 1;
+
+  // Find the known cells.
+  lineset dot = 0, solid = 0;
+  for (nonogram_sizetype i = 0; i < LEN; i++)
+    switch (CELL(i)) {
+    case nonogram_DOT:
+      dot |= BIT(i);
+      break;
+    case nonogram_SOLID:
+      solid |= BIT(i);
+      break;
+    }
+
+  // Which cells could still be dots, and which solids?
+  const lineset clear = all & ~solid;
+  const lineset open = all & ~dot;
+
+  // Where can the line be left empty up to its end?
+  const lineset tail = fill_down(clear & BIT(LEN - 1), clear);
+
+  if (RULES == 0) {
+    *maydot = clear;
+    *maysolid = 0;
+    return solid == 0;
+  }
+
+  // Find the positions consistent with everything to the left of each
+  // block, starting with an empty prefix for the first block.
+  lineset from = 1;
+  for (size_t b = 0; b < RULES; b++) {
+    const nonogram_sizetype len = RULE(b);
+    if (len > LEN)
+      return false;
+
+    // The block must cover no dots, and must not touch a solid at
+    // either end.
+    lineset place = runs_of(open, len) & ((clear << 1) | 1) &
+      (shr(clear, len) | BIT(LEN - len));
+
+    valid[b] = fill_up(from, clear << 1) & place;
+    if (valid[b] == 0)
+      return false;
+
+    // The next block can start no sooner than one cell after the gap
+    // that follows this one.
+    from = shl(shl(valid[b], len) & clear, 1);
+  }
+
+  // Working back from the end of the line, keep only the positions
+  // that can be completed to the right.
+  for (size_t b = RULES; b > 0; b--) {
+    const nonogram_sizetype len = RULE(b - 1);
+    lineset follow;
+    if (b == RULES)
+      follow = shr(tail, len) | BIT(LEN - len);
+    else
+      follow = shr(fill_down(shr(valid[b], 1) & clear, clear), len);
+    valid[b - 1] &= follow;
+    if (valid[b - 1] == 0)
+      return false;
+  }
+
+  // Any cell covered by a block in a valid position might be solid.
+  // Any cell in a gap that can stretch from the end of one block in a
+  // valid position to the start of the next might be a dot.
+  *maysolid = 0;
+  *maydot = 0;
+  lineset ends = clear & 1;
+  for (size_t b = 0; b < RULES; b++) {
+    const nonogram_sizetype len = RULE(b);
+    *maysolid |= cover(valid[b], len);
+    *maydot |= fill_up(ends, clear) &
+      fill_down(shr(valid[b], 1) & clear, clear);
+    ends = shl(valid[b], len) & clear;
+  }
+  *maydot |= fill_up(ends, clear) & tail;
+
+  return true;
+}
+
+static int bits_init(void *vp, struct nonogram_ws *ws,
+                     const struct nonogram_initargs *a)
+{
+  if (LEN > LINESET_BITS)
+    return init(vp, ws, a);
+
+  // Every block needs a cell, and every gap between blocks needs one.
+  size_t rules = RULES;
+  if (rules == 1 && RULE(0) == 0)
+    rules = 0;
+  if (rules > 0 && rules * 2 - 1 > LEN) {
+    *a->fits = 0;
+    return false;
+  }
+
+  struct nonogram_initargs sub = *a;
+  sub.rulelen = rules;
+
+  lineset valid[LINESET_BITS / 2 + 1], maydot, maysolid;
+  if (!bits_solve(&sub, valid, &maydot, &maysolid)) {
+    *a->fits = 0;
+    return false;
+  }
+  *a->fits = 1;
+
+  for (nonogram_sizetype i = 0; i < LEN; i++) {
+    if (CELL(i) != nonogram_BLANK) {
+      RESULT(i) = CELL(i);
+      continue;
+    }
+    RESULT(i) = ((maydot & BIT(i)) ? nonogram_DOT : nonogram_BLANK) |
+      ((maysolid & BIT(i)) ? nonogram_SOLID : nonogram_BLANK);
+    assert(RESULT(i) != nonogram_BLANK);
+  }
+
+  return false;
+}
@@ -0,0 +1,71 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Each guess pushes a stack frame, and each back-track pops one, so
+   deep searches would otherwise spend much of their time in malloc
+   and free.  Frames are rounded up to a power of two, and released
+   frames are kept on a list for each size. */
+
+#include <stdlib.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+nonogram_stack *nonogram_getframe(nonogram_solver *c, size_t amount)
+{
+  unsigned sc = 0;
+  while (sc < nonogram_FRAMECLASSES && ((size_t) 1 << sc) < amount)
+    sc++;
+
+  nonogram_stack *st;
+  if (sc < nonogram_FRAMECLASSES && (st = c->spare[sc])) {
+    c->spare[sc] = st->next;
+    return st;
+  }
+
+  /* Too big to keep, perhaps, but still usable */
+  st = malloc(sc < nonogram_FRAMECLASSES ? (size_t) 1 << sc : amount);
+  if (st)
+    st->sizeclass = sc;
+  return st;
+}
+
+void nonogram_putframe(nonogram_solver *c, nonogram_stack *st)
+{
+  if (st->sizeclass >= nonogram_FRAMECLASSES) {
+    free(st);
+    return;
+  }
+  st->next = c->spare[st->sizeclass];
+  c->spare[st->sizeclass] = st;
+}
+
+void nonogram_freeframes(nonogram_solver *c)
+{
+  for (unsigned sc = 0; sc < nonogram_FRAMECLASSES; sc++)
+    while (c->spare[sc]) {
+      nonogram_stack *st = c->spare[sc];
+      c->spare[sc] = st->next;
+      free(st);
+    }
+}
@@ -67,6 +67,28 @@ int nonogram_scangrid(nonogram_cell *grid, size_t width, size_t height,
 }
 #endif
 
+void nonogram_packcells(unsigned char *to,
+                        const nonogram_cell *from, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4)
+    *to++ = from[i] | from[i + 1] << 2 | from[i + 2] << 4 | from[i + 3] << 6;
+  if (i < n) {
+    unsigned char b = 0;
+    for (unsigned s = 0; i < n; i++, s += 2)
+      b |= from[i] << s;
+    *to = b;
+  }
+}
+
+void nonogram_unpackcells(nonogram_cell *to,
+                          const unsigned char *from, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    to[i] = nonogram_getpacked(from, i);
+}
+
 int nonogram_checkgrid(const nonogram_puzzle *p, const nonogram_cell *g)
 {
   size_t lineno;
@@ -0,0 +1,148 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <limits.h>
+#include <assert.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+/* Choose the colour based on what's left in the row and column. */
+static nonogram_cell likelier(const nonogram_solver *c,
+                              const struct nonogram_point *pos)
+{
+  if (c->colattr[pos->x].dot + c->rowattr[pos->y].dot >
+      c->colattr[pos->x].solid + c->rowattr[pos->y].solid)
+    return nonogram_DOT;
+  return nonogram_SOLID;
+}
+
+static void first(void *ctxt, const nonogram_solver *c,
+                  const struct nonogram_rect *area,
+                  struct nonogram_point *pos, nonogram_cell *choice)
+{
+  size_t x, y;
+  UNUSED(ctxt);
+
+  for (x = area->min.x; x < area->max.x; x++)
+    for (y = area->min.y; y < area->max.y; y++)
+      if (c->grid[x + y * c->puzzle->width] == nonogram_BLANK)
+        goto found;
+  assert(false);
+ found:
+  pos->x = x;
+  pos->y = y;
+  *choice = likelier(c, pos);
+}
+
+const struct nonogram_guesser nonogram_firstguesser = { &first };
+
+/* Pick the unknown cell with the highest score, or the first of
+   those, by column. */
+typedef int scoreproc(const nonogram_solver *c, size_t x, size_t y);
+
+static void best(const nonogram_solver *c,
+                 const struct nonogram_rect *area,
+                 struct nonogram_point *pos, nonogram_cell *choice,
+                 scoreproc *score)
+{
+  int bestscore = INT_MIN;
+
+  for (size_t x = area->min.x; x < area->max.x; x++)
+    for (size_t y = area->min.y; y < area->max.y; y++) {
+      if (c->grid[x + y * c->puzzle->width] != nonogram_BLANK)
+        continue;
+      int s = (*score)(c, x, y);
+      if (s <= bestscore)
+        continue;
+      bestscore = s;
+      pos->x = x;
+      pos->y = y;
+    }
+  assert(bestscore != INT_MIN);
+  *choice = likelier(c, pos);
+}
+
+static int unknowns(const nonogram_lineattr *attr)
+{
+  return attr->dot + attr->solid;
+}
+
+static int linescore(const nonogram_solver *c, size_t x, size_t y)
+{
+  /* Use the heuristic line scores, but ignore a line's unknown count
+     if its perpendicular has a smaller one. */
+  int inrow = unknowns(&c->rowattr[y]), incol = unknowns(&c->colattr[x]);
+  return c->rowattr[y].score + c->colattr[x].score -
+    (inrow < incol ? inrow : incol);
+}
+
+static void byscore(void *ctxt, const nonogram_solver *c,
+                    const struct nonogram_rect *area,
+                    struct nonogram_point *pos, nonogram_cell *choice)
+{
+  UNUSED(ctxt);
+  best(c, area, pos, choice, &linescore);
+}
+
+const struct nonogram_guesser nonogram_scoreguesser = { &byscore };
+
+static int constraint(const nonogram_solver *c, size_t x, size_t y)
+{
+  /* Favour the line with the fewest unknowns, breaking ties by the
+     other line. */
+  int inrow = unknowns(&c->rowattr[y]), incol = unknowns(&c->colattr[x]);
+  int least = inrow < incol ? inrow : incol;
+  int most = inrow < incol ? incol : inrow;
+  const int span = (int) (c->puzzle->width + c->puzzle->height);
+  return -(least * span + most);
+}
+
+static void constrained(void *ctxt, const nonogram_solver *c,
+                        const struct nonogram_rect *area,
+                        struct nonogram_point *pos, nonogram_cell *choice)
+{
+  UNUSED(ctxt);
+  best(c, area, pos, choice, &constraint);
+}
+
+const struct nonogram_guesser nonogram_constrainedguesser = { &constrained };
+
+static int imbalance(const nonogram_solver *c, size_t x, size_t y)
+{
+  /* Favour cells with a high imbalance of unknown dots and solids in
+     their row and column. */
+  int dot = c->rowattr[y].dot + c->colattr[x].dot;
+  int solid = c->rowattr[y].solid + c->colattr[x].solid;
+  return dot > solid ? 100 * dot / (solid + 1) : 100 * solid / (dot + 1);
+}
+
+static void imbalanced(void *ctxt, const nonogram_solver *c,
+                       const struct nonogram_rect *area,
+                       struct nonogram_point *pos, nonogram_cell *choice)
+{
+  UNUSED(ctxt);
+  best(c, area, pos, choice, &imbalance);
+}
+
+const struct nonogram_guesser nonogram_imbalanceguesser = { &imbalanced };
@@ -36,6 +36,174 @@ extern "C" {
 
   int nonogram_printrule(const struct nonogram_rule *rule, FILE *fp);
 
+  /* Move *s past the next puzzle in [*s, e), as nonogram_spscanpuzzle
+     would, but without storing it.  Return -1 if there isn't a whole
+     puzzle there. */
+  int nonogram_skippuzzle(const char **s, const char *e);
+
+  /* Return the offset of the first of 'lim' cells from 'cp' (stepping
+     by 'step') that is (find) or is not (skip) 'v', or 'lim' if there
+     is none.  Contiguous lines in either direction are scanned with
+     vector instructions where the CPU supports them.  Each costs a
+     call, so is worth it only for long runs. */
+  size_t nonogram_findcell(const nonogram_cell *cp, ptrdiff_t step,
+                           size_t lim, nonogram_cell v);
+  size_t nonogram_skipcell(const nonogram_cell *cp, ptrdiff_t step,
+                           size_t lim, nonogram_cell v);
+
+  /* Look up the result of applying a line solver to a line, and
+     write it to a->result and a->fits, returning true if found.
+     Otherwise, once the line is solved, the result can be stored. */
+  int nonogram_getcachedline(nonogram_linecache *,
+                             const struct nonogram_linesuite *,
+                             const void *conf,
+                             const struct nonogram_initargs *a);
+  void nonogram_putcachedline(nonogram_linecache *,
+                              const struct nonogram_linesuite *,
+                              const void *conf,
+                              const struct nonogram_initargs *a);
+
+
+  /* Threads are used only where POSIX threads are expected.  Define
+     nonogram_THREADS as 0 to build without them. */
+#ifndef nonogram_THREADS
+#if defined __unix__ || defined __APPLE__
+#define nonogram_THREADS 1
+#else
+#define nonogram_THREADS 0
+#endif
+#endif
+
+  /* A pool of worker threads.  nonogram_runpool calls (*proc)(ctxt,
+     i, worker) for each i in [0, n), spread across the pool's threads
+     and the caller, and returns when all calls are complete.  'worker'
+     identifies the thread, from 0 (the caller) to
+     nonogram_poolsize(pool) - 1.  nonogram_makepool returns NULL if
+     threads are not supported. */
+  struct nonogram_pool;
+  typedef void nonogram_poolproc(void *ctxt, size_t i, unsigned worker);
+  struct nonogram_pool *nonogram_makepool(unsigned threads);
+  void nonogram_freepool(struct nonogram_pool *);
+  unsigned nonogram_poolsize(const struct nonogram_pool *);
+  void nonogram_runpool(struct nonogram_pool *, size_t n,
+                        nonogram_poolproc *proc, void *ctxt);
+
+  /* Keep the heap of lines to be solved up to date.  Lines are
+     numbered with rows first, then columns.  After changing the flag
+     or score of a line, reschedule it before changing another;
+     after changing many, rebuild. */
+  void nonogram_resched(nonogram_solver *c, size_t line);
+  void nonogram_rebuildsched(nonogram_solver *c);
+
+  /* Get a stack frame of at least 'amount' bytes, reusing a released
+     one if possible.  Released frames are freed only by
+     nonogram_freeframes. */
+  nonogram_stack *nonogram_getframe(nonogram_solver *c, size_t amount);
+  void nonogram_putframe(nonogram_solver *c, nonogram_stack *st);
+  void nonogram_freeframes(nonogram_solver *c);
+
+  /* Record a cell before it is set, if there's a guess to go back
+     to, and undo all cells recorded since 'mark'. */
+#define nonogram_trailcell(C,X,Y) \
+  ((C)->usetrail && (C)->stack ? nonogram_pushtrail((C),(X),(Y)) : (void) 0)
+  void nonogram_pushtrail(nonogram_solver *c, size_t x, size_t y);
+  void nonogram_undotrail(nonogram_solver *c, size_t mark);
+  int nonogram_reservetrail(nonogram_solver *c);
+
+  /* Each line has a set of its cells changed since it was last
+     solved.  nonogram_touchcell adds a cell to the sets of its row
+     and column, nonogram_toucharea does so for a rectangle, and
+     nonogram_touchall for the whole grid.  nonogram_untouchline
+     empties a line's set as it is solved. */
+  void nonogram_touchcell(nonogram_solver *c, size_t x, size_t y);
+  void nonogram_toucharea(nonogram_solver *c, const struct nonogram_rect *r);
+  void nonogram_touchall(nonogram_solver *c);
+  void nonogram_untouchline(nonogram_solver *c, int on_row, size_t lineno);
+
+  /* Record an event in a trace.  See struct nonogram_event. */
+  void nonogram_tracepoint(nonogram_trace *, int type, int flags,
+                           unsigned level, unsigned long a,
+                           unsigned long b, unsigned long c);
+
+  /* Return 'p' if '*held' (its size) is at least 'amount' bytes, or
+     else replace it with a block of that size, recording it in
+     '*held'.  Contents are not kept.  Returns NULL (having freed 'p')
+     if out of memory. */
+  void *nonogram_reserve(void *p, size_t *held, size_t amount);
+
+  /* Each nonogram_make... function below prepares its first argument
+     for the puzzle loaded into 'c', keeping its memory where it is
+     big enough, or makes a new one if it is NULL.  On failure, it
+     frees the old one and returns NULL. */
+
+  /* A batcher collects display changes until nonogram_flushdisplay.
+     nonogram_batchmarks records rows (if 'rows') or columns [from,
+     to) as having changed marks. */
+  struct nonogram_batcher *nonogram_makebatcher(struct nonogram_batcher *,
+                                                const nonogram_solver *c);
+  void nonogram_freebatcher(struct nonogram_batcher *);
+  void nonogram_batcharea(struct nonogram_batcher *,
+                          const struct nonogram_rect *);
+  void nonogram_batchmarks(struct nonogram_batcher *, int rows,
+                           size_t from, size_t to);
+
+  /* A learner tracks which guesses each known cell follows from.
+     Before setting a cell, put what it follows from in 'because' with
+     nonogram_whyline (the known cells of the current line) or
+     nonogram_whyall (every guess), and then record it with
+     nonogram_because.  nonogram_guessed records a cell as following
+     from the latest guess.  nonogram_blame marks 'because' as the
+     cause of an inconsistency.  nonogram_checknogoods returns -1 if
+     a nogood is matched (having blamed it), or 1 if all but one cell
+     of a nogood match, so that the other must be *v (and 'because'
+     is set).  nonogram_backjump pops frames of guesses not to blame
+     for an inconsistency, and returns the top frame, whose other
+     guess follows from 'because'. */
+  struct nonogram_learner *nonogram_makelearner(struct nonogram_learner *,
+                                                const nonogram_solver *c);
+  void nonogram_freelearner(struct nonogram_learner *);
+  int nonogram_reservelearner(nonogram_solver *c);
+  void nonogram_whyline(nonogram_solver *c);
+  void nonogram_whyall(nonogram_solver *c);
+  void nonogram_because(nonogram_solver *c, size_t x, size_t y);
+  void nonogram_guessed(nonogram_solver *c, size_t x, size_t y);
+  void nonogram_blame(nonogram_solver *c);
+  int nonogram_checknogoods(nonogram_solver *c,
+                            struct nonogram_point *pos, nonogram_cell *v);
+  nonogram_stack *nonogram_backjump(nonogram_solver *c);
+
+  /* A SAT solver takes on the unknown cells of a solver's grid.
+     nonogram_runsat searches until (*test)(data) is false, and
+     returns nonogram_FOUND with the next solution in the grid,
+     nonogram_FINISHED if there are no more, nonogram_UNFINISHED or
+     nonogram_ERROR.  nonogram_clearsat unsets the cells of the last
+     solution, returning true if there was one. */
+  struct nonogram_sat *nonogram_makesat(const nonogram_solver *c);
+  void nonogram_freesat(struct nonogram_sat *);
+  int nonogram_runsat(nonogram_solver *c, int (*test)(void *), void *data);
+  int nonogram_clearsat(nonogram_solver *c);
+
+  /* Configure one solver to solve like another. */
+  int nonogram_copyconf(nonogram_solver *to, const nonogram_solver *from);
+
+  /* A prober solves copies of a solver's state with one more cell
+     set.  nonogram_probe returns NULL if that leads to an
+     inconsistency, or otherwise the resulting grid, which remains
+     valid until the next probe into the same slot (0 or 1). */
+  struct nonogram_prober *nonogram_makeprober(struct nonogram_prober *,
+                                              const nonogram_solver *c);
+  void nonogram_freeprober(struct nonogram_prober *);
+  const nonogram_cell *nonogram_probe(struct nonogram_prober *,
+                                      const nonogram_solver *c,
+                                      const struct nonogram_point *pos,
+                                      nonogram_cell v, int slot);
+
+  /* In a parallel search, a solver hands the alternative of each
+     guess to its worker, having made the guess at 'pos'.  Returns -1
+     if out of memory. */
+  int nonogram_spawn(struct nonogram_worker *,
+                     const nonogram_solver *c,
+                     const struct nonogram_point *pos);
 
 
   /* Alignment technique seen here:
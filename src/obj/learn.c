@@ -0,0 +1,379 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Conflict-directed back-jumping with nogood learning.  Each known
+   cell carries the set of guesses that it follows from, identified by
+   the depth of their stack frames.  A cell deduced from a line follows
+   from whatever the line's known cells follow from, so an
+   inconsistency in a line can be blamed on just some of the guesses.
+   Guesses not to blame are jumped back over, and the values of those
+   that are can't all occur together again, so they are remembered as
+   a nogood, to be checked whenever the lines have nothing more to
+   give.  Blaming a line's deductions on all of its known cells is
+   coarse, but cheap, and is enough to step over guesses made in
+   unrelated parts of the grid. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+typedef unsigned long word;
+#define WORDBITS (CHAR_BIT * sizeof(word))
+
+/* Longer nogoods seldom match, so they aren't kept. */
+#define MAXLITS 32
+
+struct lit {
+  size_t cell;
+  nonogram_cell val;
+};
+
+struct nogood {
+  size_t start, len;
+};
+
+struct nonogram_learner {
+  /* for each cell, 'words' words of guesses, in 'whyheld' bytes */
+  size_t cells, words, whyheld;
+  word *why;
+
+  /* what the next cell set follows from, and what the last
+     inconsistency did, if 'blamed' */
+  word *because, *conflict;
+  int blamed;
+
+  /* at most solver's 'learning' nogoods, oldest first */
+  struct nogood *nogood;
+  size_t nogoods, nogoodheld;
+  struct lit *lit;
+  size_t lits, litcap;
+};
+
+#define depthof(C) ((C)->stack ? (C)->stack->depth : 0u)
+#define hasguess(S,D) (((S)[((D) - 1) / WORDBITS] >> (((D) - 1) % WORDBITS)) & 1u)
+#define addguess(S,D) ((S)[((D) - 1) / WORDBITS] |= (word) 1 << (((D) - 1) % WORDBITS))
+#define delguess(S,D) ((S)[((D) - 1) / WORDBITS] &= ~((word) 1 << (((D) - 1) % WORDBITS)))
+
+void nonogram_freelearner(struct nonogram_learner *L)
+{
+  if (!L) return;
+  free(L->why);
+  free(L->because);
+  free(L->conflict);
+  free(L->nogood);
+  free(L->lit);
+  free(L);
+}
+
+struct nonogram_learner *nonogram_makelearner(struct nonogram_learner *L,
+                                              const nonogram_solver *c)
+{
+  if (!L) {
+    L = malloc(sizeof *L);
+    if (!L) return NULL;
+    L->words = 1;
+    L->why = NULL;
+    L->because = calloc(1, sizeof(word));
+    L->conflict = calloc(1, sizeof(word));
+    L->nogood = NULL;
+    L->lit = NULL;
+    L->litcap = 0;
+    if (!L->because || !L->conflict) {
+      nonogram_freelearner(L);
+      return NULL;
+    }
+  }
+
+  /* Sets already widened for deep guesses stay that wide. */
+  L->cells = c->puzzle->width * c->puzzle->height;
+  L->why = nonogram_reserve(L->why, &L->whyheld,
+                            L->cells * L->words * sizeof(word));
+  L->nogood = nonogram_reserve(L->nogood, &L->nogoodheld,
+                               c->learning * sizeof *L->nogood);
+  if (!L->why || !L->nogood) {
+    nonogram_freelearner(L);
+    return NULL;
+  }
+  memset(L->why, 0, L->cells * L->words * sizeof(word));
+  memset(L->because, 0, L->words * sizeof(word));
+  memset(L->conflict, 0, L->words * sizeof(word));
+  L->blamed = false;
+  L->nogoods = 0;
+  L->lits = 0;
+  return L;
+}
+
+/* Make room for the guess about to be made. */
+int nonogram_reservelearner(nonogram_solver *c)
+{
+  struct nonogram_learner *L = c->learner;
+  const size_t need = depthof(c) / WORDBITS + 1;
+  if (need <= L->words)
+    return 0;
+
+  word *because = realloc(L->because, need * sizeof(word));
+  if (!because) return -1;
+  L->because = because;
+  word *conflict = realloc(L->conflict, need * sizeof(word));
+  if (!conflict) return -1;
+  L->conflict = conflict;
+
+  word *why = realloc(L->why, L->cells * need * sizeof(word));
+  if (!why) return -1;
+  L->why = why;
+  L->whyheld = L->cells * need * sizeof(word);
+  for (size_t i = L->cells; i-- > 0; ) {
+    memmove(why + i * need, why + i * L->words, L->words * sizeof(word));
+    memset(why + i * need + L->words, 0,
+           (need - L->words) * sizeof(word));
+  }
+  L->words = need;
+  return 0;
+}
+
+/* Gather what a line's known cells follow from, if it is
+   inconsistent or has had cells deduced in c->work. */
+void nonogram_whyline(nonogram_solver *c)
+{
+  struct nonogram_learner *L = c->learner;
+  const size_t width = c->puzzle->width, words = L->words;
+  const nonogram_cell *line;
+  size_t len, cell, step, i, k;
+
+  memset(L->because, 0, words * sizeof(word));
+  if (!c->stack)
+    return;
+
+  if (c->on_row) {
+    line = c->grid + c->lineno * width;
+    len = width;
+    cell = c->lineno * width, step = 1;
+  } else {
+    line = c->mirror + c->lineno * c->puzzle->height;
+    len = c->puzzle->height;
+    cell = c->lineno, step = width;
+  }
+
+  /* Nothing is set, so nothing need be explained. */
+  if (c->fits != 0) {
+    for (i = 0; i < len; i++)
+      if (line[i] == nonogram_BLANK &&
+          (c->work[i] == nonogram_DOT || c->work[i] == nonogram_SOLID))
+        break;
+    if (i == len)
+      return;
+  }
+
+  for (i = 0; i < len; i++)
+    if (line[i] != nonogram_BLANK) {
+      const word *w = L->why + (cell + i * step) * words;
+      for (k = 0; k < words; k++)
+        L->because[k] |= w[k];
+    }
+}
+
+void nonogram_whyall(nonogram_solver *c)
+{
+  struct nonogram_learner *L = c->learner;
+  memset(L->because, 0, L->words * sizeof(word));
+  for (unsigned d = depthof(c); d > 0; d--)
+    addguess(L->because, d);
+}
+
+void nonogram_because(nonogram_solver *c, size_t x, size_t y)
+{
+  struct nonogram_learner *L = c->learner;
+  memcpy(L->why + (x + y * c->puzzle->width) * L->words, L->because,
+         L->words * sizeof(word));
+}
+
+void nonogram_guessed(nonogram_solver *c, size_t x, size_t y)
+{
+  struct nonogram_learner *L = c->learner;
+  word *w = L->why + (x + y * c->puzzle->width) * L->words;
+  memset(w, 0, L->words * sizeof(word));
+  addguess(w, depthof(c));
+}
+
+void nonogram_blame(nonogram_solver *c)
+{
+  struct nonogram_learner *L = c->learner;
+  memcpy(L->conflict, L->because, L->words * sizeof(word));
+  L->blamed = true;
+}
+
+int nonogram_checknogoods(nonogram_solver *c,
+                          struct nonogram_point *pos, nonogram_cell *v)
+{
+  struct nonogram_learner *L = c->learner;
+
+  for (size_t n = 0; n < L->nogoods; n++) {
+    const struct lit *lit = L->lit + L->nogood[n].start;
+    const size_t len = L->nogood[n].len;
+    size_t open = len;
+
+    /* Is there at most one cell yet to match? */
+    for (size_t i = 0; i < len; i++) {
+      nonogram_cell g = c->grid[lit[i].cell];
+      if (g == nonogram_BLANK) {
+        if (open < len)
+          goto next;
+        open = i;
+      } else if (g != lit[i].val) {
+        goto next;
+      }
+    }
+
+    memset(L->because, 0, L->words * sizeof(word));
+    for (size_t i = 0; i < len; i++)
+      if (i != open) {
+        const word *w = L->why + lit[i].cell * L->words;
+        for (size_t k = 0; k < L->words; k++)
+          L->because[k] |= w[k];
+      }
+
+    if (open == len) {
+#if nonogram_LOGLEVEL > 0
+      if (c->log.file) {
+        fprintf(c->log.file, "%*sNogood of %zu cells matched\n",
+                c->log.indent, "", len);
+        fflush(c->log.file);
+      }
+#endif
+      nonogram_blame(c);
+      return -1;
+    }
+    pos->x = lit[open].cell % c->puzzle->width;
+    pos->y = lit[open].cell / c->puzzle->width;
+    *v = lit[open].val ^ nonogram_BOTH;
+    return 1;
+
+  next:
+    ;
+  }
+  return 0;
+}
+
+/* Remember the values of the guesses in the conflict set. */
+static void learn(nonogram_solver *c, size_t len)
+{
+  struct nonogram_learner *L = c->learner;
+
+  if (len == 0 || len > MAXLITS || c->learning == 0)
+    return;
+
+  /* Forget the older half when full. */
+  if (L->nogoods == c->learning) {
+    size_t drop = (L->nogoods + 1) / 2;
+    size_t from = drop < L->nogoods ? L->nogood[drop].start : L->lits;
+    memmove(L->lit, L->lit + from, (L->lits - from) * sizeof *L->lit);
+    L->lits -= from;
+    L->nogoods -= drop;
+    for (size_t n = 0; n < L->nogoods; n++) {
+      L->nogood[n] = L->nogood[n + drop];
+      L->nogood[n].start -= from;
+    }
+  }
+
+  if (L->lits + len > L->litcap) {
+    size_t cap = L->litcap ? L->litcap : 64;
+    while (cap < L->lits + len)
+      cap *= 2;
+    struct lit *tmp = realloc(L->lit, cap * sizeof *tmp);
+    if (!tmp) return;
+    L->lit = tmp;
+    L->litcap = cap;
+  }
+
+  struct nogood *ng = &L->nogood[L->nogoods++];
+  ng->start = L->lits;
+  ng->len = len;
+  for (const nonogram_stack *st = c->stack; st; st = st->next)
+    if (hasguess(L->conflict, st->depth)) {
+      struct lit *lit = &L->lit[L->lits++];
+      lit->cell = st->guesspos.x + st->guesspos.y * c->puzzle->width;
+      lit->val = c->grid[lit->cell];
+    }
+  assert(L->lits == ng->start + len);
+
+#if nonogram_LOGLEVEL > 0
+  if (c->log.file) {
+    fprintf(c->log.file, "%*sLearned nogood of %zu cells\n",
+            c->log.indent, "", len);
+    fflush(c->log.file);
+  }
+#endif
+}
+
+nonogram_stack *nonogram_backjump(nonogram_solver *c)
+{
+  struct nonogram_learner *L = c->learner;
+  nonogram_stack *st = c->stack;
+  const int blamed = L->blamed;
+
+  L->blamed = false;
+  if (!st)
+    return NULL;
+
+  /* A solution or failed probe is down to every guess. */
+  if (!blamed) {
+    memset(L->conflict, 0, L->words * sizeof(word));
+    for (unsigned d = st->depth; d > 0; d--)
+      addguess(L->conflict, d);
+  }
+
+  /* Guesses not to blame would fail the other way too. */
+  while (st && !hasguess(L->conflict, st->depth)) {
+#if nonogram_LOGLEVEL > 0
+    if (c->log.file) {
+      fprintf(c->log.file, "%*sJumping back over guess at (%zu,%zu)\n",
+              c->log.indent, "", st->guesspos.x, st->guesspos.y);
+      fflush(c->log.file);
+    }
+#endif
+    c->log.indent -= 2;
+    if (c->log.file)
+      fprintf(c->log.file, "%*s}\n", c->log.indent, "");
+    c->stack = st->next;
+    nonogram_putframe(c, st);
+    st = c->stack;
+  }
+  if (!st)
+    return NULL;
+
+  if (blamed) {
+    size_t len = 0;
+    for (const nonogram_stack *s = st; s; s = s->next)
+      len += hasguess(L->conflict, s->depth);
+    learn(c, len);
+  }
+
+  /* The other way of the guess follows from the rest. */
+  memcpy(L->because, L->conflict, L->words * sizeof(word));
+  delguess(L->because, st->depth);
+  return st;
+}
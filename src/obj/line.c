@@ -26,11 +26,18 @@
 #include <stdlib.h>
 
 #include "nonogram.h"
+#include "internal.h"
 
 #ifndef nonogram_LOGLEVEL
 #define nonogram_LOGLEVEL 1
 #endif
 
+/* Runs of dots before a block, and of non-solids after the last, are
+   scanned here a cell at a time.  Only a run that lasts longer than
+   this is handed over to the vector scanner, which costs more than
+   the inline loop until then. */
+#define SCAN_RUN 16
+
 int nonogram_checkline(const nonogram_sizetype *r,
                        size_t rlen, ptrdiff_t rstep,
                        const nonogram_cell *st, size_t len, ptrdiff_t step)
@@ -87,17 +94,112 @@ int nonogram_push(const nonogram_cell *line,
                   size_t rulelen, ptrdiff_t rulestep,
                   nonogram_sizetype *pos, ptrdiff_t posstep,
                   ptrdiff_t *solid, FILE *log, int level, int indent)
+{
+  size_t block;
+
+  /* no block can be placed earlier than the start */
+  for (block = 0; block < rulelen; block++)
+    pos[block * posstep] = 0;
+
+  return nonogram_pushfrom(line, linelen, linestep, rule, rulelen, rulestep,
+                           pos, posstep, solid, 0, log, level, indent);
+}
+
+int nonogram_pushmemo(struct nonogram_pushmemo *memo, int dir,
+                      const nonogram_cell *line,
+                      size_t linelen, ptrdiff_t linestep,
+                      const nonogram_sizetype *rule,
+                      size_t rulelen, ptrdiff_t rulestep,
+                      nonogram_sizetype *pos, ptrdiff_t posstep,
+                      ptrdiff_t *solid, FILE *log, int level, int indent)
+{
+  nonogram_cell *oldline;
+  nonogram_sizetype *oldpos;
+  ptrdiff_t *oldsolid;
+  size_t first, i, block;
+  int ok;
+
+  if (!memo || rulelen == 0)
+    return nonogram_push(line, linelen, linestep, rule, rulelen, rulestep,
+                         pos, posstep, solid, log, level, indent);
+
+  oldline = memo->line[dir];
+  oldpos = memo->pos[dir];
+  oldsolid = memo->solid[dir];
+
+  /* find the first changed cell, and make sure that only unknown
+     cells have changed, otherwise the old positions are no longer
+     lower bounds */
+  first = linelen + 1;
+  if (memo->valid[dir]) {
+    for (first = 0;
+         first < linelen && oldline[first] == line[first * linestep];
+         first++)
+      ;
+    for (i = first; i < linelen; i++)
+      if (oldline[i] != nonogram_BLANK && oldline[i] != line[i * linestep])
+        break;
+    if (i < linelen)
+      first = linelen + 1;
+  }
+
+  if (first > linelen) {
+    ok = nonogram_push(line, linelen, linestep, rule, rulelen, rulestep,
+                       pos, posstep, solid, log, level, indent);
+  } else {
+    /* blocks that end (with their trailing dot) before the first
+       change are still in place; the last block must always be
+       placed again to check for trailing solids */
+    for (block = 0; block + 1 < rulelen &&
+           oldpos[block] + rule[block * rulestep] < first; block++)
+      solid[block] = oldsolid[block];
+    for (i = 0; i < rulelen; i++)
+      pos[i * posstep] = oldpos[i];
+    ok = nonogram_pushfrom(line, linelen, linestep, rule, rulelen, rulestep,
+                           pos, posstep, solid, block, log, level, indent);
+  }
+
+  memo->valid[dir] = ok;
+  if (ok) {
+    /* cells before the first change are already recorded */
+    for (i = first > linelen ? 0 : first; i < linelen; i++)
+      oldline[i] = line[i * linestep];
+    for (i = 0; i < rulelen; i++) {
+      oldpos[i] = pos[i * posstep];
+      oldsolid[i] = solid[i];
+    }
+  }
+  return ok;
+}
+
+/* Move a block's position on to at least 'posv', the first cell it
+   could occupy after the previous block.  If it's already beyond that,
+   it can stay there only if no solid would be left uncovered. */
+static void follow(const nonogram_cell *line, ptrdiff_t linestep,
+                   nonogram_sizetype *pos, nonogram_sizetype posv)
+{
+  const nonogram_cell *cp = line + posv * linestep;
+  nonogram_sizetype i;
+
+  for (i = posv; i < *pos && *cp != nonogram_SOLID; i++)
+    cp += linestep;
+  if (i < *pos || *pos <= posv)
+    *pos = posv;
+}
+
+int nonogram_pushfrom(const nonogram_cell *line,
+                      size_t linelen, ptrdiff_t linestep,
+                      const nonogram_sizetype *rule,
+                      size_t rulelen, ptrdiff_t rulestep,
+                      nonogram_sizetype *pos, ptrdiff_t posstep,
+                      ptrdiff_t *solid, size_t block,
+                      FILE *log, int level, int indent)
 {
   /* working variables */
   size_t i;
   const nonogram_cell *cp, *cp2;
   nonogram_sizetype posv, rulev;
 
-  /* initial state */
-  size_t block = 0;
-
-  if (rulelen > 0) pos[block * posstep] = 0;
-
 #if nonogram_LOGLEVEL > 1
   if (log && level > 1) {
     size_t rn;
@@ -132,6 +234,10 @@ int nonogram_push(const nonogram_cell *line,
   indent = indent;
 #endif
 
+  if (block < rulelen)
+    follow(line, linestep, &pos[block * posstep], block == 0 ? 0 :
+           pos[(block - 1) * posstep] + 1 + rule[(block - 1) * rulestep]);
+
   while (block < rulelen) {
     /* find first/next non-dot:
        stop if block won't fit into remainder of line */
@@ -143,8 +249,14 @@ int nonogram_push(const nonogram_cell *line,
               indent, "", (int) block, (int) posv, "", (int) rulev, 0);
 #endif
     cp = line + (posv * linestep);
-    while (posv + rulev < linelen && *cp == nonogram_DOT)
+    i = 0;
+    while (posv + rulev < linelen && *cp == nonogram_DOT && i++ < SCAN_RUN)
       posv++, cp += linestep;
+    if (i > SCAN_RUN) {
+      i = nonogram_skipcell(cp, linestep, linelen - rulev - posv,
+                            nonogram_DOT);
+      posv += i, cp += i * linestep;
+    }
     pos[block * posstep] = posv;
 
 #if nonogram_LOGLEVEL > 2
@@ -260,15 +372,21 @@ int nonogram_push(const nonogram_cell *line,
       continue;
     }
 
-    /* the block is in place, so try the next */
+    /* the block is in place, so try the next, but not before where
+       it has already been */
     posv = pos[block * posstep] + 1 + rule[block * rulestep];
     if (block + 1 < rulelen) {
-      pos[++block * posstep] = posv;
+      block++;
+      follow(line, linestep, &pos[block * posstep], posv);
     } else {
       /* no more blocks, so just check for any remaining solids */
       cp = line + (posv * linestep);
-      while (posv < linelen && *cp != nonogram_SOLID)
+      i = 0;
+      while (posv < linelen && *cp != nonogram_SOLID && i++ < SCAN_RUN)
         posv++, cp += linestep;
+      if (i > SCAN_RUN)
+        posv += nonogram_findcell(cp, linestep, linelen - posv,
+                                  nonogram_SOLID);
       /* if a solid was found... */
       if (posv < linelen) {
 #if nonogram_LOGLEVEL > 2
@@ -0,0 +1,344 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/*
+ * Entries are kept in a hash table with chaining, and on a
+ * doubly-linked list in order of use, so the least recently used can
+ * be discarded when the cache would exceed its limit.  Each entry is
+ * a single allocation holding the rule, then the line and the result
+ * packed at four cells per byte.  Where threads are available, one
+ * lock guards the lot, so solvers in different threads may share a
+ * cache.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#if nonogram_THREADS
+#include <pthread.h>
+#define LOCK(C) pthread_mutex_lock(&(C)->lock)
+#define UNLOCK(C) pthread_mutex_unlock(&(C)->lock)
+#else
+#define LOCK(C) ((void) 0)
+#define UNLOCK(C) ((void) 0)
+#endif
+
+struct entry {
+  struct entry *chain, *newer, *older;
+  uint_least64_t hash;
+  const struct nonogram_linesuite *suite;
+  const void *conf;
+  size_t rulelen, linelen, size;
+  int fits;
+};
+
+struct nonogram_linecache {
+  struct entry **bucket, *newest, *oldest;
+  size_t buckets;
+  struct nonogram_linecachestats stats;
+#if nonogram_THREADS
+  pthread_mutex_t lock;
+#endif
+};
+
+#define RULEOF(E) \
+  ((nonogram_sizetype *) \
+   ((char *) (E) + align(sizeof(struct entry), nonogram_sizetype)))
+#define LINEOF(E) ((unsigned char *) (RULEOF(E) + (E)->rulelen))
+#define RESULTOF(E) (LINEOF(E) + PACKED((E)->linelen))
+#define PACKED(N) (((N) + 3) / 4)
+#define ENTRYSIZE(R,N) \
+  (align(sizeof(struct entry), nonogram_sizetype) \
+   + (R) * sizeof(nonogram_sizetype) + 2 * PACKED(N))
+
+/* Get byte 'i' of the packed form of a line. */
+static unsigned char packed(const nonogram_cell *cp, size_t len,
+                            ptrdiff_t step, size_t i)
+{
+  unsigned char r = 0;
+  for (size_t x = i * 4; x < len && x < i * 4 + 4; x++)
+    r |= (cp[x * step] & 3u) << (x % 4 * 2);
+  return r;
+}
+
+#define FNV_BASIS UINT64_C(14695981039346656037)
+#define FNV_PRIME UINT64_C(1099511628211)
+
+static uint_least64_t mix(uint_least64_t h, const void *p, size_t n)
+{
+  const unsigned char *b = p;
+  while (n-- > 0)
+    h = (h ^ *b++) * FNV_PRIME;
+  return h & UINT64_C(0xffffffffffffffff);
+}
+
+static uint_least64_t hashof(const struct nonogram_linesuite *suite,
+                             const void *conf,
+                             const struct nonogram_initargs *a)
+{
+  uint_least64_t h = FNV_BASIS;
+  h = mix(h, &suite, sizeof suite);
+  h = mix(h, &conf, sizeof conf);
+  for (size_t i = 0; i < a->rulelen; i++)
+    h = mix(h, &a->rule[i * a->rulestep], sizeof(nonogram_sizetype));
+  h = mix(h, &a->linelen, sizeof a->linelen);
+  for (size_t i = 0; i < PACKED(a->linelen); i++) {
+    unsigned char b = packed(a->line, a->linelen, a->linestep, i);
+    h = mix(h, &b, 1);
+  }
+  return h;
+}
+
+static int matches(const struct entry *e, uint_least64_t hash,
+                   const struct nonogram_linesuite *suite, const void *conf,
+                   const struct nonogram_initargs *a)
+{
+  if (e->hash != hash || e->suite != suite || e->conf != conf ||
+      e->rulelen != a->rulelen || e->linelen != a->linelen)
+    return false;
+  const nonogram_sizetype *rule = RULEOF(e);
+  for (size_t i = 0; i < a->rulelen; i++)
+    if (rule[i] != a->rule[i * a->rulestep])
+      return false;
+  const unsigned char *line = LINEOF(e);
+  for (size_t i = 0; i < PACKED(a->linelen); i++)
+    if (line[i] != packed(a->line, a->linelen, a->linestep, i))
+      return false;
+  return true;
+}
+
+/* Is 'f' for the same line as 'e'? */
+static int same(const struct entry *e, const struct entry *f)
+{
+  return e->hash == f->hash && e->suite == f->suite && e->conf == f->conf &&
+    e->rulelen == f->rulelen && e->linelen == f->linelen &&
+    memcmp(RULEOF(e), RULEOF(f),
+           (char *) RESULTOF(e) - (char *) RULEOF(e)) == 0;
+}
+
+static void unlink_use(nonogram_linecache *c, struct entry *e)
+{
+  if (e->newer)
+    e->newer->older = e->older;
+  else
+    c->newest = e->older;
+  if (e->older)
+    e->older->newer = e->newer;
+  else
+    c->oldest = e->newer;
+}
+
+static void link_use(nonogram_linecache *c, struct entry *e)
+{
+  e->newer = NULL;
+  e->older = c->newest;
+  if (c->newest)
+    c->newest->newer = e;
+  else
+    c->oldest = e;
+  c->newest = e;
+}
+
+static void discard(nonogram_linecache *c, struct entry *e)
+{
+  struct entry **ep = &c->bucket[e->hash & (c->buckets - 1)];
+  while (*ep != e)
+    ep = &(*ep)->chain;
+  *ep = e->chain;
+  unlink_use(c, e);
+  c->stats.bytes -= e->size;
+  c->stats.entries--;
+  free(e);
+}
+
+/* Keep the chains short by doubling the table when it's full. */
+static void grow(nonogram_linecache *c)
+{
+  size_t n = c->buckets ? c->buckets * 2 : 64;
+  size_t extra = (n - c->buckets) * sizeof *c->bucket;
+  if (c->stats.bytes + extra > c->stats.maxbytes)
+    return;
+  struct entry **nb = calloc(n, sizeof *nb);
+  if (!nb)
+    return;
+  for (size_t i = 0; i < c->buckets; i++)
+    for (struct entry *e = c->bucket[i], *next; e; e = next) {
+      next = e->chain;
+      e->chain = nb[e->hash & (n - 1)];
+      nb[e->hash & (n - 1)] = e;
+    }
+  free(c->bucket);
+  c->bucket = nb;
+  c->buckets = n;
+  c->stats.bytes += extra;
+}
+
+nonogram_linecache *nonogram_makelinecache(size_t maxbytes)
+{
+  nonogram_linecache *c = malloc(sizeof *c);
+  if (!c)
+    return NULL;
+  c->bucket = NULL;
+  c->buckets = 0;
+  c->newest = c->oldest = NULL;
+  memset(&c->stats, 0, sizeof c->stats);
+  c->stats.maxbytes = maxbytes;
+  c->stats.bytes = sizeof *c;
+#if nonogram_THREADS
+  if (pthread_mutex_init(&c->lock, NULL) != 0) {
+    free(c);
+    return NULL;
+  }
+#endif
+  return c;
+}
+
+void nonogram_clearlinecache(nonogram_linecache *c)
+{
+  LOCK(c);
+  while (c->oldest)
+    discard(c, c->oldest);
+  UNLOCK(c);
+}
+
+void nonogram_freelinecache(nonogram_linecache *c)
+{
+  if (!c)
+    return;
+  nonogram_clearlinecache(c);
+#if nonogram_THREADS
+  pthread_mutex_destroy(&c->lock);
+#endif
+  free(c->bucket);
+  free(c);
+}
+
+void nonogram_getlinecachestats(const nonogram_linecache *cc,
+                                struct nonogram_linecachestats *s)
+{
+  /* Only the lock is changed. */
+  nonogram_linecache *c = (nonogram_linecache *) cc;
+  LOCK(c);
+  *s = c->stats;
+  UNLOCK(c);
+}
+
+int nonogram_getcachedline(nonogram_linecache *c,
+                           const struct nonogram_linesuite *suite,
+                           const void *conf,
+                           const struct nonogram_initargs *a)
+{
+  /* Hash before taking the lock, as it's most of the work. */
+  uint_least64_t hash = hashof(suite, conf, a);
+
+  LOCK(c);
+  if (c->buckets > 0) {
+    for (struct entry *e = c->bucket[hash & (c->buckets - 1)];
+         e; e = e->chain) {
+      if (!matches(e, hash, suite, conf, a))
+        continue;
+
+      const unsigned char *res = RESULTOF(e);
+      for (size_t x = 0; x < a->linelen; x++)
+        a->result[x * a->resultstep] = (res[x / 4] >> (x % 4 * 2)) & 3u;
+      *a->fits = e->fits;
+
+      unlink_use(c, e);
+      link_use(c, e);
+      c->stats.hits++;
+      UNLOCK(c);
+      return true;
+    }
+  }
+  c->stats.misses++;
+  UNLOCK(c);
+  return false;
+}
+
+void nonogram_putcachedline(nonogram_linecache *c,
+                            const struct nonogram_linesuite *suite,
+                            const void *conf,
+                            const struct nonogram_initargs *a)
+{
+  size_t size = ENTRYSIZE(a->rulelen, a->linelen);
+
+  /* Fill in the entry before taking the lock. */
+  struct entry *e = malloc(size);
+  if (!e)
+    return;
+  e->hash = hashof(suite, conf, a);
+  e->suite = suite;
+  e->conf = conf;
+  e->rulelen = a->rulelen;
+  e->linelen = a->linelen;
+  e->size = size;
+  e->fits = *a->fits;
+
+  nonogram_sizetype *rule = RULEOF(e);
+  for (size_t i = 0; i < a->rulelen; i++)
+    rule[i] = a->rule[i * a->rulestep];
+  unsigned char *line = LINEOF(e), *res = RESULTOF(e);
+  for (size_t i = 0; i < PACKED(a->linelen); i++) {
+    line[i] = packed(a->line, a->linelen, a->linestep, i);
+    res[i] = packed(a->result, a->linelen, a->resultstep, i);
+  }
+
+  LOCK(c);
+
+  /* Another thread may have got there first. */
+  if (c->buckets > 0)
+    for (struct entry *f = c->bucket[e->hash & (c->buckets - 1)];
+         f; f = f->chain)
+      if (same(e, f)) {
+        UNLOCK(c);
+        free(e);
+        return;
+      }
+
+  if (c->stats.entries >= c->buckets)
+    grow(c);
+
+  /* Make room, or give up if there will never be room. */
+  if (c->buckets == 0 ||
+      sizeof *c + c->buckets * sizeof *c->bucket + size > c->stats.maxbytes) {
+    UNLOCK(c);
+    free(e);
+    return;
+  }
+  while (c->oldest && c->stats.bytes + size > c->stats.maxbytes) {
+    discard(c, c->oldest);
+    c->stats.evictions++;
+  }
+
+  struct entry **bp = &c->bucket[e->hash & (c->buckets - 1)];
+  e->chain = *bp;
+  *bp = e;
+  link_use(c, e);
+  c->stats.bytes += size;
+  c->stats.entries++;
+  UNLOCK(c);
+}
@@ -0,0 +1,140 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Solving many puzzles at once, each worker thread keeping one solver
+   for all the puzzles it takes on, so that its workspace is allocated
+   only as often as puzzles outgrow it. */
+
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+struct worker {
+  nonogram_solver solver;
+  struct nonogram_result *result;
+  nonogram_cell *grid;
+  size_t cells;
+};
+
+struct job {
+  const nonogram_puzzle *puzzles;
+  struct nonogram_result *results;
+  unsigned long maxsols;
+  struct worker *worker;
+};
+
+static void present(void *ctxt)
+{
+  struct worker *w = ctxt;
+  const nonogram_puzzle *p = w->solver.puzzle;
+  if (w->result->solutions++ == 0 && w->result->grid)
+    memcpy(w->result->grid, w->grid, p->width * p->height);
+}
+
+static void solveone(void *vj, size_t i, unsigned wno)
+{
+  struct job *j = vj;
+  struct worker *w = &j->worker[wno];
+  const nonogram_puzzle *p = &j->puzzles[i];
+  struct nonogram_result *r = &j->results[i];
+  const size_t cells = p->width * p->height;
+
+  r->solutions = 0;
+  w->result = r;
+
+  /* The grid is kept for the next puzzle, if it's big enough. */
+  if (cells > w->cells || !w->grid) {
+    nonogram_cell *grid = realloc(w->grid, cells ? cells : 1);
+    if (!grid) {
+      r->status = nonogram_ERROR;
+      return;
+    }
+    w->grid = grid;
+    w->cells = cells;
+  }
+  nonogram_cleargrid(w->grid, p->width, p->height);
+
+  if (nonogram_load(&w->solver, p, w->grid, cells) < 0) {
+    r->status = nonogram_ERROR;
+    return;
+  }
+  do
+    r->status = nonogram_solve(&w->solver, NULL, NULL);
+  while (r->status == nonogram_FOUND &&
+         (j->maxsols == 0 || r->solutions < j->maxsols));
+  nonogram_unload(&w->solver);
+}
+
+int nonogram_solvepuzzles(const nonogram_puzzle *puzzles,
+                          struct nonogram_result *results, size_t n,
+                          unsigned threads, unsigned long maxsols,
+                          nonogram_setupproc *setup, void *ctxt)
+{
+  static const struct nonogram_client client = { &present };
+  struct nonogram_pool *pool = threads > 1 && n > 1 ?
+    nonogram_makepool(threads < n ? threads : n) : NULL;
+  const unsigned workers = pool ? nonogram_poolsize(pool) : 1;
+  struct job j;
+  unsigned made;
+  int rc = 0;
+
+  j.puzzles = puzzles;
+  j.results = results;
+  j.maxsols = maxsols;
+  j.worker = malloc(workers * sizeof *j.worker);
+  if (!j.worker) {
+    nonogram_freepool(pool);
+    return -1;
+  }
+
+  for (made = 0; made < workers; made++) {
+    struct worker *w = &j.worker[made];
+    nonogram_initsolver(&w->solver);
+    w->grid = NULL;
+    w->cells = 0;
+    if (setup && (*setup)(ctxt, &w->solver) < 0) {
+      nonogram_termsolver(&w->solver);
+      rc = -1;
+      break;
+    }
+    nonogram_setclient(&w->solver, &client, w);
+  }
+
+  if (rc == 0) {
+    if (pool)
+      nonogram_runpool(pool, n, &solveone, &j);
+    else
+      for (size_t i = 0; i < n; i++)
+        solveone(&j, i, 0);
+  }
+
+  while (made > 0) {
+    struct worker *w = &j.worker[--made];
+    nonogram_termsolver(&w->solver);
+    free(w->grid);
+  }
+  free(j.worker);
+  nonogram_freepool(pool);
+  return rc;
+}
@@ -43,6 +43,7 @@ extern "C" {
 #include <stddef.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
 
 #ifndef false
 #define false 0
@@ -73,6 +74,16 @@ extern "C" {
 #define nonogram_cleargrid(G,W,H) nonogram_setgrid((G),(W),(H),nonogram_BLANK)
 #define nonogram_xfergrid(T,F,W,H) memcpy(T,F,(W)*(H)*sizeof(nonogram_cell))
 
+  /* Cells can be packed four to a byte, with cell I in bits 2*(I%4)
+     and 2*(I%4)+1 of byte I/4. */
+#define nonogram_packedsize(N) (((N) + 3u) / 4u)
+#define nonogram_getpacked(P,I) \
+  ((nonogram_cell) (((P)[(I) / 4u] >> ((I) % 4u * 2u)) & 3u))
+  void nonogram_packcells(unsigned char *to,
+                          const nonogram_cell *from, size_t n);
+  void nonogram_unpackcells(nonogram_cell *to,
+                            const unsigned char *from, size_t n);
+
 
   /******* puzzle representation *******/
 
@@ -98,6 +109,32 @@ extern "C" {
                               nonogram_errorproc *, void *);
   int nonogram_fscanpuzzle(nonogram_puzzle *p, FILE *fp);
 
+  /* As nonogram_fscanpuzzle_ef, but reading lines into *bufp, of
+     *capp bytes, which is grown with realloc as needed, and may be
+     kept for the next puzzle.  Start with NULL and 0, and free it
+     when done.  None of these functions keeps any state of its own,
+     so different threads may parse different puzzles at once. */
+  int nonogram_fscanpuzzle_r(nonogram_puzzle *p, FILE *fp,
+                             char **bufp, size_t *capp,
+                             nonogram_errorproc *, void *);
+
+  /* A collection of puzzles, one after another in a file, or in
+     [s, e), which must outlive it.  A file is mapped into memory
+     where possible.  The start of each puzzle is found when the
+     corpus is opened, and any of them can be parsed from where it
+     lies, by several threads at once.  The puzzles end at the first
+     that is incomplete or malformed, and nonogram_corpusend gives
+     the offset of that point. */
+  typedef struct nonogram_corpus nonogram_corpus;
+  nonogram_corpus *nonogram_opencorpus(const char *filename);
+  nonogram_corpus *nonogram_makecorpus(const char *s, const char *e);
+  void nonogram_closecorpus(nonogram_corpus *);
+  size_t nonogram_corpussize(const nonogram_corpus *);
+  size_t nonogram_corpusend(const nonogram_corpus *);
+  int nonogram_corpuspuzzle_ef(const nonogram_corpus *, size_t i,
+                               nonogram_puzzle *p,
+                               nonogram_errorproc *, void *);
+
   int nonogram_makepuzzle(nonogram_puzzle *p, const nonogram_cell *g,
                           size_t w, size_t h);
   void nonogram_freepuzzle(nonogram_puzzle *p);
@@ -162,6 +199,118 @@ extern "C" {
   int nonogram_setlog(nonogram_solver *c,
                       FILE *logfile, int indent, int level);
 
+  /* Solve lines with up to 'threads' threads (including the caller).
+     Returns -1 if more than one is requested but threads are not
+     supported. */
+  int nonogram_setthreads(nonogram_solver *c, unsigned threads);
+
+  /* Store the copies of the grid saved when guessing at four cells
+     per byte, at some cost in speed. */
+  int nonogram_setpackstack(nonogram_solver *c, int packed);
+
+  /* Instead of saving the unknown part of the grid when guessing,
+     record each cell as it is set, and undo them when back-tracking.
+     packstack is then ignored. */
+  int nonogram_settrail(nonogram_solver *c, int on);
+
+  /* Before guessing, try each unknown cell both ways, solving at most
+     'lines' lines each time, and keep what follows either way.  0
+     disables this. */
+  int nonogram_setprobing(nonogram_solver *c, unsigned lines);
+
+  /* On an inconsistency, work out which guesses led to it, jump back
+     over the rest, and remember up to 'nogoods' combinations of
+     values that can't occur together, to check before each guess.  0
+     disables this. */
+  int nonogram_setlearning(nonogram_solver *c, unsigned nogoods);
+
+  /* Instead of guessing, hand what's left of the puzzle to a SAT
+     solver once the line solvers stall, and let it find the
+     solutions. */
+  int nonogram_setsat(nonogram_solver *c, int on);
+
+  /* Keep a record of each line's last push in each direction, so
+     that the next push of the line can resume from the first block
+     affected by changes.  Each push then costs a comparison and copy
+     of the line, which pays off only on long lines with many
+     blocks. */
+  int nonogram_setpushmemo(nonogram_solver *c, int on);
+
+
+  /******* line-result cache *******/
+
+  /* A cache of line-solver results keyed on the line solver, the rule
+     and the contents of the line.  It may be shared by several
+     solvers, in any threads.  The least recently used
+     results are discarded to keep the cache within 'maxbytes',
+     including its own overheads. */
+  typedef struct nonogram_linecache nonogram_linecache;
+  struct nonogram_linecachestats {
+    unsigned long hits, misses, evictions;
+    size_t entries, bytes, maxbytes;
+  };
+
+  nonogram_linecache *nonogram_makelinecache(size_t maxbytes);
+  void nonogram_freelinecache(nonogram_linecache *);
+  void nonogram_clearlinecache(nonogram_linecache *);
+  void nonogram_getlinecachestats(const nonogram_linecache *,
+                                  struct nonogram_linecachestats *);
+
+  /* Use the cache (or none if NULL) for subsequent puzzles.  The
+     cache must outlive its use by the solver. */
+  int nonogram_setlinecache(nonogram_solver *c, nonogram_linecache *);
+
+
+  /******* tracing *******/
+
+  /* A ring of the most recent events of one solver, kept whether or
+     not the solver has been built with logging.  Only the thread
+     running the solver writes to it, and takes no locks to do so;
+     other threads may read or dump it at the same time. */
+  typedef struct nonogram_trace nonogram_trace;
+
+  /* 'flags' has nonogram_EVROW for a row, and the value of a cell for
+     those events which set one.  'level' is the line solver's level,
+     or the depth of the stack.  'when' is nonogram_monotime(), if the
+     trace is timed, or 0. */
+  enum {
+    nonogram_EVLINE = 1, /* line 'a' chosen, with score 'b' */
+    nonogram_EVEND, /* line 'a' changed 'b' cells, leaving 'c' */
+    nonogram_EVCONFLICT, /* line 'a' inconsistent */
+    nonogram_EVGUESS, /* cell ('a', 'b') guessed */
+    nonogram_EVPUSH, /* guess at ('a', 'b') saved */
+    nonogram_EVFLIP, /* cell ('a', 'b') set to the other guess */
+    nonogram_EVPOP, /* guess at ('a', 'b') restored, leaving 'c' */
+    nonogram_EVFIX, /* cell ('a', 'b') set by probing or nogood */
+    nonogram_EVFOUND /* solution found */
+  };
+#define nonogram_EVROW 4
+  struct nonogram_event {
+    unsigned long long when;
+    unsigned char type, flags;
+    unsigned short level;
+    unsigned long a, b, c;
+  };
+
+  /* Keep the last 'records' events (rounded up to a power of 2). */
+  nonogram_trace *nonogram_maketrace(size_t records, int timed);
+  void nonogram_freetrace(nonogram_trace *);
+
+  /* Copy up to 'max' of the most recent events, oldest first,
+     returning how many. */
+  size_t nonogram_readtrace(const nonogram_trace *,
+                            struct nonogram_event *, size_t max);
+
+  /* Write the most recent events in a binary form, and turn that
+     back into text.  They return -1 on error. */
+  int nonogram_dumptrace(const nonogram_trace *, FILE *);
+  int nonogram_decodetrace(FILE *in, FILE *out);
+
+  /* Record the events of subsequent puzzles (or none if NULL).  The
+     trace must outlive its use by the solver, and not be used by
+     another solver at the same time. */
+  int nonogram_settrace(nonogram_solver *c, nonogram_trace *);
+
 
   /******* solver activity *******/
 
@@ -172,6 +321,76 @@ extern "C" {
   int nonogram_runcycles_tries(nonogram_solver *c, int *cycles);
   int nonogram_runcycles_until(nonogram_solver *c, clock_t lim);
   int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data);
+
+  /* A deadline 'when' in nanoseconds of nonogram_monotime(), which
+     reads a monotonic clock where there is one.  nonogram_testdeadline
+     reads the clock only every so many calls, tuned from how long
+     calls have been taking apart, so as to read it at least every
+     'slack' nanoseconds.  Set one up with nonogram_setdeadline, and
+     keep using it for the same deadline, as the tuning carries
+     over. */
+  struct nonogram_deadline {
+    unsigned long long when, slack, last;
+    unsigned long every, left;
+  };
+  unsigned long long nonogram_monotime(void);
+  void nonogram_setdeadline(struct nonogram_deadline *,
+                            unsigned long long when,
+                            unsigned long long slack);
+  int nonogram_testdeadline(void *);
+  int nonogram_runlines_deadline(nonogram_solver *c, int *lines,
+                                 struct nonogram_deadline *);
+  int nonogram_runcycles_deadline(nonogram_solver *c,
+                                  struct nonogram_deadline *);
+
+  /* Solve until a solution is found (nonogram_FOUND, having been
+     presented), there are no more (nonogram_FINISHED), or an error
+     (nonogram_ERROR).  If 'steps' is not NULL, it is decremented by
+     each step, and nonogram_UNFINISHED is returned when it is zero;
+     likewise if the deadline, if not NULL, expires.  Call again to
+     carry on. */
+  int nonogram_solve(nonogram_solver *c, unsigned long *steps,
+                     struct nonogram_deadline *deadline);
+
+  /* Explore the rest of the search tree with up to 'threads' threads,
+     presenting each solution to the client in turn.  (*more)(data)
+     is called after each one, and the search stops if it returns
+     false.  No line is left to be solved afterwards. */
+  int nonogram_runsearch(nonogram_solver *c, unsigned threads,
+                         int (*more)(void *), void *data);
+  /* Load the puzzle, solve until a second solution is found, and
+     unload it again.  The number of solutions (0, 1 or 2, meaning at
+     least 2) is returned, or -1 on error, and the first is copied to
+     'first' if not NULL.  The client's present function, the display
+     and the log are not used. */
+  int nonogram_checkunique(nonogram_solver *c,
+                           const nonogram_puzzle *puzzle,
+                           nonogram_cell *grid, int remcells,
+                           nonogram_cell *first);
+
+  /* Solve each of 'n' puzzles from blank grids, with up to 'threads'
+     threads (including the caller).  Each thread uses one solver for
+     all the puzzles it takes, set up by (*setup)(ctxt, solver) if not
+     NULL, which may fail by returning -1.  Each is called in the
+     calling thread, before any puzzle is solved, so it must give each
+     solver its own trace, if any, though they may share a line cache;
+     the client is replaced.  results[i] gets the status for puzzles[i]:
+     nonogram_FINISHED if all solutions were found, nonogram_FOUND if
+     'maxsols' (0 meaning no limit) were, or nonogram_ERROR.  It also
+     gets the number of solutions, and if its 'grid' is not NULL, the
+     first solution is copied there.  -1 is returned if the solvers
+     could not be set up. */
+  struct nonogram_result {
+    int status;
+    unsigned long solutions;
+    nonogram_cell *grid;
+  };
+  typedef int nonogram_setupproc(void *ctxt, nonogram_solver *);
+  int nonogram_solvepuzzles(const nonogram_puzzle *puzzles,
+                            struct nonogram_result *results, size_t n,
+                            unsigned threads, unsigned long maxsols,
+                            nonogram_setupproc *setup, void *ctxt);
+
   enum { /* return codes for above calls */
     nonogram_UNLOADED = 0,
     nonogram_FINISHED = 1,
@@ -200,6 +419,13 @@ extern "C" {
   struct nonogram_point { size_t x, y; };
   struct nonogram_rect { struct nonogram_point min, max; };
 
+  /* A set of cells or lines, member i being bit i % nonogram_CHANGEBITS
+     of element i / nonogram_CHANGEBITS. */
+  typedef unsigned long nonogram_changeword;
+#define nonogram_CHANGEBITS (CHAR_BIT * sizeof(nonogram_changeword))
+#define nonogram_changed(S,I) \
+  (((S)[(I) / nonogram_CHANGEBITS] >> ((I) % nonogram_CHANGEBITS)) & 1u)
+
   typedef void nonogram_redrawareaproc(void *ctxt,
                                        const struct nonogram_rect *area);
   nonogram_deprecated(typedef nonogram_redrawareaproc nonogram_redrawarea_f);
@@ -208,16 +434,70 @@ extern "C" {
   typedef void nonogram_markproc(void *ctxt, size_t from, size_t to);
   nonogram_deprecated(typedef nonogram_markproc nonogram_mark_f);
 
+  /* Changes collected for a display's flush function: the smallest
+     rectangle covering the cells to be redrawn (empty if none), the
+     cells themselves, row y's being at cells + y * cellwords, and the
+     rows and columns whose marks have changed. */
+  struct nonogram_batch {
+    struct nonogram_rect area;
+    const nonogram_changeword *cells;
+    size_t cellwords;
+    const nonogram_changeword *rows, *cols;
+  };
+  typedef void nonogram_flushproc(void *ctxt, const struct nonogram_batch *);
+
   struct nonogram_display {
     nonogram_redrawareaproc *redrawarea;
     nonogram_focusproc *rowfocus, *colfocus;
     nonogram_markproc *rowmark, *colmark;
+    nonogram_flushproc *flush;
   };
 
   int nonogram_setdisplay(nonogram_solver *c,
                           const struct nonogram_display *display,
                           void *display_data);
 
+  /* If the display has a flush function, collect cells to redraw and
+     lines to mark for it, instead of calling redrawarea, rowmark and
+     colmark, and flush them after every 'lines' lines are solved,
+     and before a solution is presented.  Focus changes are still
+     reported as they happen.  0 (the default) disables this. */
+  int nonogram_setdisplaybatch(nonogram_solver *c, unsigned lines);
+
+  /* Flush any changes collected for the display now. */
+  int nonogram_flushdisplay(nonogram_solver *c);
+
+
+  /******* choosing guesses *******/
+
+  /* Choose an unknown cell within 'area' (which contains at least
+     one), and the value to try first. */
+  typedef void nonogram_guessproc(void *ctxt, const nonogram_solver *c,
+                                  const struct nonogram_rect *area,
+                                  struct nonogram_point *pos,
+                                  nonogram_cell *choice);
+  struct nonogram_guesser {
+    nonogram_guessproc *choose;
+  };
+
+  /* the first unknown cell, by column (the default) */
+  extern const struct nonogram_guesser nonogram_firstguesser;
+
+  /* the cell with the highest sum of row and column scores, less the
+     smaller number of unknown cells in either */
+  extern const struct nonogram_guesser nonogram_scoreguesser;
+
+  /* a cell in the line with the fewest unknown cells */
+  extern const struct nonogram_guesser nonogram_constrainedguesser;
+
+  /* the cell whose row and column most favour one value over the
+     other */
+  extern const struct nonogram_guesser nonogram_imbalanceguesser;
+
+  int nonogram_setguesser(nonogram_solver *c,
+                          const struct nonogram_guesser *guesser,
+                          void *guesser_data);
+
 #define nonogram_limitrow(S,R,X,F) \
   ((R) < (S)->puzzle->height ? (X) : (F))
 #define nonogram_limitcol(S,C,X,F) \
@@ -277,12 +557,26 @@ extern "C" {
     ptrdiff_t linestep, rulestep, resultstep;
   };
 
+  /* what a solver knows of a line's past, for suites with 'resume' */
+  struct nonogram_linehist {
+    /* the line's previous pushes, or NULL; see nonogram_pushmemo */
+    struct nonogram_pushmemo *memo;
+
+    /* the cells that may have changed since the line was last
+       solved, by any suite, or NULL if not known; cells not in it
+       are as they were */
+    const nonogram_changeword *changed;
+  };
+
   typedef void nonogram_prepproc(void *, const struct nonogram_lim *,
                                  struct nonogram_req *);
   nonogram_deprecated(typedef nonogram_prepproc nonogram_prep_f);
   typedef int nonogram_initproc(void *, struct nonogram_ws *ws,
                                 const struct nonogram_initargs *);
   nonogram_deprecated(typedef nonogram_initproc nonogram_init_f);
+  typedef int nonogram_resumeproc(void *, struct nonogram_ws *ws,
+                                  const struct nonogram_initargs *,
+                                  const struct nonogram_linehist *);
   typedef int nonogram_stepproc(void *, void *ws);
   nonogram_deprecated(typedef nonogram_stepproc nonogram_step_f);
   typedef void nonogram_termproc(void *);
@@ -294,6 +588,7 @@ extern "C" {
     nonogram_initproc *init; /* initialise for a particular line */
     nonogram_stepproc *step; /* perform a single step */
     nonogram_termproc *term; /* terminate line-processing */
+    nonogram_resumeproc *resume; /* init, given history; optional */
   };
 
   int nonogram_setlinesolver(nonogram_solver *c, nonogram_level,
@@ -334,7 +629,16 @@ extern "C" {
     nonogram_AFCOMP,
 
     /* Fast, then fast-complete */
-    nonogram_AFFCOMP
+    nonogram_AFFCOMP,
+
+    /* Bit-parallel fast-complete for lines of up to 64 cells */
+    nonogram_ABITS,
+
+    /* Complete, by dynamic programming */
+    nonogram_ADP,
+
+    /* Fast, then DP */
+    nonogram_AFASTDP
   };
   int nonogram_setalgo(nonogram_solver *, int);
 
@@ -363,6 +667,42 @@ extern "C" {
                     nonogram_sizetype *pos, ptrdiff_t posstep,
                     ptrdiff_t *solid, FILE *log, int level, int indent);
 
+  /* As nonogram_push, but blocks before 'block' are already in place,
+     with 'solid' as an earlier push left it, and the other positions
+     are lower bounds, as left by an earlier push of the same line
+     with fewer known cells. */
+  int nonogram_pushfrom(const nonogram_cell *line,
+                        size_t linelen, ptrdiff_t linestep,
+                        const nonogram_sizetype *rule,
+                        size_t rulelen, ptrdiff_t rulestep,
+                        nonogram_sizetype *pos, ptrdiff_t posstep,
+                        ptrdiff_t *solid, size_t block,
+                        FILE *log, int level, int indent);
+
+  /* The solver keeps one of these for each line, recording the
+     results of the last push in each direction ('dir' is 0 for
+     towards the start, 1 for towards the end).  line[dir] holds the
+     line's cells in the order pushed, and pos[dir] and solid[dir] the
+     block positions and push workspace, in the order the blocks were
+     pushed. */
+  struct nonogram_pushmemo {
+    nonogram_cell *line[2];
+    nonogram_sizetype *pos[2];
+    ptrdiff_t *solid[2];
+    int valid[2];
+  };
+
+  /* As nonogram_push, but if 'memo' is not NULL, resume from the
+     first block affected by cells changed since the last push in the
+     same direction. */
+  int nonogram_pushmemo(struct nonogram_pushmemo *memo, int dir,
+                        const nonogram_cell *line,
+                        size_t linelen, ptrdiff_t linestep,
+                        const nonogram_sizetype *rule,
+                        size_t rulelen, ptrdiff_t rulestep,
+                        nonogram_sizetype *pos, ptrdiff_t posstep,
+                        ptrdiff_t *solid, FILE *log, int level, int indent);
+
 
 
   /******* 'complete' line solver *******/
@@ -400,6 +740,20 @@ extern "C" {
   typedef struct nonogram_fastconf nonogram_fcompconf;
 
 
+  /******* 'bits (bit-parallel fast-complete)' line solver *******/
+
+  extern const struct nonogram_linesuite nonogram_bitsuite;
+  typedef struct nonogram_fastwork nonogram_bitswork;
+  typedef struct nonogram_fastconf nonogram_bitsconf;
+
+
+  /******* 'dp (dynamic-programming complete)' line solver *******/
+
+  extern const struct nonogram_linesuite nonogram_dpsuite;
+  typedef struct nonogram_fastwork nonogram_dpwork;
+  typedef struct nonogram_fastconf nonogram_dpconf;
+
+
   /******* 'null' line solver *******/
 
   extern const struct nonogram_linesuite nonogram_nullsuite;
@@ -463,13 +817,26 @@ extern "C" {
 
   typedef struct nonogram_stack {
     struct nonogram_stack *next;
-    nonogram_cell *grid;
+    nonogram_cell *grid; /* rows packed if solver's packstack is set */
     struct nonogram_rect unkarea;
     struct nonogram_point guesspos;
     nonogram_lineattr *rowattr, *colattr;
     int remcells;
+    unsigned sizeclass; /* allocated size is 1 << sizeclass */
+    size_t trailmark; /* no grid or attributes if solver's trail is used */
+    unsigned depth; /* number of frames up to and including this one */
   } nonogram_stack;
 
+  /* a cell as it was before being set, with its row and column */
+  struct nonogram_trailent {
+    size_t cell;
+    nonogram_cell old;
+    nonogram_lineattr row, col;
+  };
+
+  /* Released stack frames are kept for reuse, by size. */
+#define nonogram_FRAMECLASSES 32
+
   struct nonogram_lsnt {
     void *context;
     const char *name;
@@ -482,9 +849,13 @@ extern "C" {
 
     void *display_data;
     const struct nonogram_display *display;
+
+    void *guesser_data;
+    const struct nonogram_guesser *guesser;
     struct nonogram_rect editarea; /* temporary workspace */
 
     struct nonogram_ws workspace;
+    struct nonogram_req wsheld; /* what 'workspace' has room for */
     struct nonogram_lsnt *linesolver; /* an array of length 'levels' */
     nonogram_level levels;
 
@@ -495,14 +866,19 @@ extern "C" {
 
     const nonogram_puzzle *puzzle;
     struct nonogram_lim lim;
-    nonogram_cell *work;
+    nonogram_cell *work; /* first of a block of 'workheld' bytes */
+    size_t workheld;
     nonogram_lineattr *rowattr, *colattr;
     nonogram_level *rowflag, *colflag;
+    size_t *heap, *heappos, heaplen; /* lines with non-zero flags */
 
     nonogram_bool *rowdir, *coldir; /* to be removed */
 
     nonogram_stack *stack; /* pushed guesses */
+    nonogram_stack *spare[nonogram_FRAMECLASSES]; /* unused frames */
     nonogram_cell *grid;
+    nonogram_cell *mirror; /* column-major copy of grid */
+    size_t mirrorheld;
     int remcells, reminfo;
     struct nonogram_rect unkarea;
 
@@ -514,6 +890,50 @@ extern "C" {
     int fits, lineno;
     nonogram_level level;
     unsigned on_row : 1, focus : 1, status : 2, reversed : 1, alloc : 1;
+    unsigned uncached : 1; /* store line result when DONE */
+    unsigned packstack : 1; /* stack grids are packed */
+    unsigned usetrail : 1; /* undo through trail, not stack grids */
+    unsigned usesat : 1; /* search with SAT rather than guesses */
+    unsigned pushmemo : 1; /* keep each line's last pushes */
+
+    /* cells set since the first guess */
+    struct nonogram_trailent *trail;
+    size_t traillen, trailcap;
+
+    nonogram_linecache *linecache;
+    nonogram_trace *trace;
+
+    /* previous pushes of each line */
+    struct nonogram_pushmemo *rowmemo, *colmemo;
+    size_t memoheld;
+
+    /* cells changed since each line was last solved, 'rowwords' per
+       row and 'colwords' per column */
+    nonogram_changeword *rowchanged, *colchanged;
+    size_t rowwords, colwords, changedheld;
+
+    /* solving several lines at once */
+    unsigned threads;
+    struct nonogram_parallel *parallel;
+
+    /* set when part of a parallel search */
+    struct nonogram_worker *worker;
+
+    /* trying cells both ways before guessing */
+    unsigned probing;
+    struct nonogram_prober *prober;
+
+    /* display changes not yet flushed, and lines solved since the
+       last flush */
+    unsigned batchlines, batched;
+    struct nonogram_batcher *batcher;
+
+    /* back-jumping, and remembering what led to inconsistencies */
+    unsigned learning;
+    struct nonogram_learner *learner;
+
+    /* the SAT solver, once guessing would have started */
+    struct nonogram_sat *sat;
 
     /* logfile */
     struct nonogram_log log, tmplog;
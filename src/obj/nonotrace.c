@@ -0,0 +1,58 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Turn a dumped trace back into text. */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "nonogram.h"
+
+int main(int argc, char **argv)
+{
+  FILE *fp = stdin;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [filename]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1) {
+    fp = fopen(argv[1], "rb");
+    if (!fp) {
+      perror(argv[1]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (nonogram_decodetrace(fp, stdout) < 0) {
+    fprintf(stderr, "%s: bad trace\n", argv[0]);
+    if (fp != stdin)
+      fclose(fp);
+    return EXIT_FAILURE;
+  }
+
+  if (fp != stdin)
+    fclose(fp);
+  return EXIT_SUCCESS;
+}
@@ -154,9 +154,11 @@ static void search_section(const struct nonogram_initargs *a,
   }
 }
 
-static int compinit(void *ct, struct nonogram_ws *c,
-                    const struct nonogram_initargs *a)
+static int compresume(void *ct, struct nonogram_ws *c,
+                      const struct nonogram_initargs *a,
+                      const struct nonogram_linehist *h)
 {
+  struct nonogram_pushmemo *memo = h ? h->memo : NULL;
   size_t b;
   struct working w;
   nonogram_sizetype last_end, pos;
@@ -186,24 +188,25 @@ static int compinit(void *ct, struct nonogram_ws *c,
 
   /* Find the left-most limits of the blocks.  This gives our starting
      position. */
-  if (!nonogram_push(a->line, a->linelen, a->linestep,
-                     a->rule, a->rulelen, a->rulestep,
-                     w.left, 1,
-                     w.pushspace,
-                     a->log->file, a->log->level, a->log->indent)) {
+  if (!nonogram_pushmemo(memo, 0, a->line, a->linelen, a->linestep,
+                         a->rule, a->rulelen, a->rulestep,
+                         w.left, 1,
+                         w.pushspace,
+                         a->log->file, a->log->level, a->log->indent)) {
     assert(*a->fits == 0);
     return false;
   }
 
   /* Find the right-most limits of the blocks. */
   assert(a->rulelen > 0);
-  if (!nonogram_push(a->line + (a->linelen - 1) * a->linestep, a->linelen,
-                     -a->linestep,
-                     a->rule + (a->rulelen - 1) * a->rulestep, a->rulelen,
-                     -a->rulestep,
-                     w.right + (a->rulelen - 1) , -1,
-                     w.pushspace,
-                     a->log->file, a->log->level, a->log->indent)) {
+  if (!nonogram_pushmemo(memo, 1,
+                         a->line + (a->linelen - 1) * a->linestep, a->linelen,
+                         -a->linestep,
+                         a->rule + (a->rulelen - 1) * a->rulestep, a->rulelen,
+                         -a->rulestep,
+                         w.right + (a->rulelen - 1) , -1,
+                         w.pushspace,
+                         a->log->file, a->log->level, a->log->indent)) {
     assert(*a->fits == 0);
     return false;
   }
@@ -283,8 +286,14 @@ static int compinit(void *ct, struct nonogram_ws *c,
   return false;
 }
 
+static int compinit(void *ct, struct nonogram_ws *c,
+                    const struct nonogram_initargs *a)
+{
+  return compresume(ct, c, a, NULL);
+}
+
 const struct nonogram_linesuite nonogram_olsaksuite = {
-  &compprep, &compinit, 0, 0
+  &compprep, &compinit, 0, 0, &compresume
 };
 
 
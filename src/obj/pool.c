@@ -0,0 +1,207 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* A fixed set of worker threads which, with the calling thread, share
+   out the indices of a job between them.  Where threads are not
+   available, nonogram_makepool fails, and callers fall back to doing
+   the work themselves. */
+
+#include <stdlib.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#if nonogram_THREADS
+#include <pthread.h>
+
+struct nonogram_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t start, done;
+
+  /* the calling thread is worker 0 */
+  unsigned threads;
+  pthread_t *tid;
+
+  /* the current job */
+  nonogram_poolproc *proc;
+  void *ctxt;
+  size_t n, next;
+  unsigned long generation;
+  unsigned busy;
+  int quit;
+};
+
+struct workerarg {
+  struct nonogram_pool *pool;
+  unsigned id;
+};
+
+/* Claim and run indices of the current job until there are none
+   left. */
+static void work(struct nonogram_pool *p, unsigned id)
+{
+  for (;;) {
+    pthread_mutex_lock(&p->lock);
+    size_t i = p->next;
+    if (i < p->n)
+      p->next++;
+    pthread_mutex_unlock(&p->lock);
+    if (i >= p->n)
+      return;
+    (*p->proc)(p->ctxt, i, id);
+  }
+}
+
+static void *worker(void *vp)
+{
+  struct workerarg *wa = vp;
+  struct nonogram_pool *p = wa->pool;
+  unsigned id = wa->id;
+  unsigned long seen = 0;
+
+  free(wa);
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (!p->quit && p->generation == seen)
+      pthread_cond_wait(&p->start, &p->lock);
+    if (p->quit)
+      break;
+    seen = p->generation;
+    pthread_mutex_unlock(&p->lock);
+
+    work(p, id);
+
+    pthread_mutex_lock(&p->lock);
+    if (--p->busy == 0)
+      pthread_cond_signal(&p->done);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+struct nonogram_pool *nonogram_makepool(unsigned threads)
+{
+  if (threads < 1)
+    threads = 1;
+
+  struct nonogram_pool *p = malloc(sizeof *p);
+  if (!p)
+    return NULL;
+  p->tid = malloc(sizeof *p->tid * threads);
+  if (!p->tid) {
+    free(p);
+    return NULL;
+  }
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->start, NULL);
+  pthread_cond_init(&p->done, NULL);
+  p->generation = 0;
+  p->busy = 0;
+  p->quit = false;
+  p->n = p->next = 0;
+
+  for (p->threads = 1; p->threads < threads; p->threads++) {
+    struct workerarg *wa = malloc(sizeof *wa);
+    if (!wa)
+      break;
+    wa->pool = p;
+    wa->id = p->threads;
+    if (pthread_create(&p->tid[p->threads], NULL, &worker, wa)) {
+      free(wa);
+      break;
+    }
+  }
+  return p;
+}
+
+void nonogram_freepool(struct nonogram_pool *p)
+{
+  if (!p)
+    return;
+  pthread_mutex_lock(&p->lock);
+  p->quit = true;
+  pthread_cond_broadcast(&p->start);
+  pthread_mutex_unlock(&p->lock);
+  for (unsigned i = 1; i < p->threads; i++)
+    pthread_join(p->tid[i], NULL);
+  pthread_cond_destroy(&p->done);
+  pthread_cond_destroy(&p->start);
+  pthread_mutex_destroy(&p->lock);
+  free(p->tid);
+  free(p);
+}
+
+unsigned nonogram_poolsize(const struct nonogram_pool *p)
+{
+  return p->threads;
+}
+
+void nonogram_runpool(struct nonogram_pool *p, size_t n,
+                      nonogram_poolproc *proc, void *ctxt)
+{
+  pthread_mutex_lock(&p->lock);
+  p->proc = proc;
+  p->ctxt = ctxt;
+  p->n = n;
+  p->next = 0;
+  p->busy = p->threads - 1;
+  p->generation++;
+  pthread_cond_broadcast(&p->start);
+  pthread_mutex_unlock(&p->lock);
+
+  work(p, 0);
+
+  pthread_mutex_lock(&p->lock);
+  while (p->busy > 0)
+    pthread_cond_wait(&p->done, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+}
+
+#else
+
+struct nonogram_pool *nonogram_makepool(unsigned threads)
+{
+  UNUSED(threads);
+  return NULL;
+}
+
+void nonogram_freepool(struct nonogram_pool *p)
+{
+  UNUSED(p);
+}
+
+unsigned nonogram_poolsize(const struct nonogram_pool *p)
+{
+  UNUSED(p);
+  return 1;
+}
+
+void nonogram_runpool(struct nonogram_pool *p, size_t n,
+                      nonogram_poolproc *proc, void *ctxt)
+{
+  UNUSED(p);
+  for (size_t i = 0; i < n; i++)
+    (*proc)(ctxt, i, 0);
+}
+
+#endif
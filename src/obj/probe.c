@@ -0,0 +1,137 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Failed-literal probing: a second solver, configured like the first,
+   is given a copy of the first's state with one more cell set, and
+   solves lines until none are left, an inconsistency is found, or its
+   limit is reached.  It never guesses. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+struct nonogram_prober {
+  nonogram_solver solver;
+  nonogram_cell *grid, *result[2];
+  size_t held;
+};
+
+void nonogram_freeprober(struct nonogram_prober *p)
+{
+  if (!p)
+    return;
+  nonogram_termsolver(&p->solver);
+  free(p->grid);
+  free(p);
+}
+
+struct nonogram_prober *nonogram_makeprober(struct nonogram_prober *p,
+                                            const nonogram_solver *c)
+{
+  const size_t cells = c->puzzle->width * c->puzzle->height;
+  if (p) {
+    /* Its solver keeps its own buffers for the next load. */
+    nonogram_unload(&p->solver);
+  } else {
+    p = malloc(sizeof *p);
+    if (!p)
+      return NULL;
+    nonogram_initsolver(&p->solver);
+    p->grid = NULL;
+  }
+  p->grid = nonogram_reserve(p->grid, &p->held,
+                             cells * 3 * sizeof(nonogram_cell));
+  if (!p->grid ||
+      nonogram_copyconf(&p->solver, c) < 0) {
+    nonogram_freeprober(p);
+    return NULL;
+  }
+  p->result[0] = p->grid + cells;
+  p->result[1] = p->result[0] + cells;
+  nonogram_cleargrid(p->grid, c->puzzle->width, c->puzzle->height);
+
+  /* It must not probe itself. */
+  p->solver.probing = 0;
+
+  if (nonogram_load(&p->solver, c->puzzle, p->grid, (int) cells) < 0) {
+    nonogram_freeprober(p);
+    return NULL;
+  }
+  return p;
+}
+
+static int always(void *data)
+{
+  UNUSED(data);
+  return true;
+}
+
+const nonogram_cell *nonogram_probe(struct nonogram_prober *p,
+                                    const nonogram_solver *c,
+                                    const struct nonogram_point *pos,
+                                    nonogram_cell v, int slot)
+{
+  nonogram_solver *s = &p->solver;
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+  const size_t lines = width + height;
+
+  /* Copy the state, which has no line in progress. */
+  memcpy(s->grid, c->grid, width * height * sizeof(nonogram_cell));
+  memcpy(s->mirror, c->mirror, width * height * sizeof(nonogram_cell));
+  memcpy(s->rowattr, c->rowattr, lines * sizeof(nonogram_lineattr));
+  memcpy(s->rowflag, c->rowflag, lines * sizeof(nonogram_level));
+  s->remcells = c->remcells;
+  s->unkarea = c->unkarea;
+  s->reversed = false;
+  nonogram_touchall(s);
+
+  /* Set the cell, and have its row and column solved again. */
+  s->grid[pos->x + pos->y * width] = v;
+  s->mirror[pos->y + pos->x * height] = v;
+  s->remcells--;
+  if (v == nonogram_DOT)
+    s->rowattr[pos->y].dot--, s->colattr[pos->x].dot--;
+  else
+    s->rowattr[pos->y].solid--, s->colattr[pos->x].solid--;
+  s->rowflag[pos->y] = s->colflag[pos->x] = s->levels;
+  s->reminfo = 0;
+  for (size_t i = 0; i < lines; i++)
+    s->reminfo += !!s->rowflag[i];
+  nonogram_rebuildsched(s);
+
+  /* Stop before the solver would present a solution or guess, and
+     only between lines. */
+  unsigned solved = 0;
+  while (s->remcells > 0 &&
+         (s->status != nonogram_EMPTY ||
+          (s->reminfo > 0 && solved < c->probing)))
+    if (nonogram_runcycles(s, &always, NULL) == nonogram_LINE)
+      solved++;
+
+  if (s->remcells < 0)
+    return NULL;
+  memcpy(p->result[slot], s->grid, width * height * sizeof(nonogram_cell));
+  return p->result[slot];
+}
@@ -23,6 +23,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <string.h>
 #include <float.h>
@@ -67,9 +68,44 @@ int nonogram_fscanpuzzle(nonogram_puzzle *p, FILE *fp)
 
 int nonogram_fscanpuzzle_ef(nonogram_puzzle *p, FILE *fp,
                             nonogram_errorproc *ef, void *eh)
+{
+  char *buf = NULL;
+  size_t cap = 0;
+  int rc = nonogram_fscanpuzzle_r(p, fp, &buf, &cap, ef, eh);
+  free(buf);
+  return rc;
+}
+
+/* Read a whole line into *bufp, growing it as necessary, and return
+   its length, 0 at the end of the file, or (size_t) -1 if out of
+   memory. */
+static size_t readline(FILE *fp, char **bufp, size_t *capp)
+{
+  size_t len = 0;
+
+  for (;;) {
+    if (*capp - len < 2) {
+      size_t cap = *capp ? *capp * 2 : 128;
+      char *buf = realloc(*bufp, cap);
+      if (!buf)
+        return (size_t) -1;
+      *bufp = buf;
+      *capp = cap;
+    }
+    if (!fgets(*bufp + len, *capp - len, fp))
+      return len;
+    len += strlen(*bufp + len);
+    if (len > 0 && (*bufp)[len - 1] == '\n')
+      return len;
+  }
+}
+
+int nonogram_fscanpuzzle_r(nonogram_puzzle *p, FILE *fp,
+                           char **bufp, size_t *capp,
+                           nonogram_errorproc *ef, void *eh)
 {
   struct linectxt ctxt;
-  static char line[400];
+  size_t len;
   int rc = 0;
 
   p->row = p->col = NULL;
@@ -85,9 +121,16 @@ int nonogram_fscanpuzzle_ef(nonogram_puzzle *p, FILE *fp,
 
   while (((ctxt.noheight || ctxt.rowno < p->height) ||
           (ctxt.nowidth || ctxt.colno < p->width)) &&
-         fgets(line, sizeof line, fp) &&
-         (rc = scanline(p, &ctxt, line, line + strlen(line), ef, eh)))
+         (len = readline(fp, bufp, capp)) > 0) {
+    if (len == (size_t) -1) {
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt.lineno);
+      rc = 0;
+      break;
+    }
+    if (!(rc = scanline(p, &ctxt, *bufp, *bufp + len, ef, eh)))
+      break;
     ctxt.lineno++;
+  }
 
   if (ef) {
     if (ctxt.noheight)
@@ -731,7 +774,7 @@ static int skipndigit(const char **pp, const char *e)
 {
   while (*pp < e && **pp && !isdigit((int) **pp))
     (*pp)++;
-  return **pp;
+  return *pp < e && **pp;
 }
 
 static int matchword(const char *s, const char *e, const char *t)
@@ -749,7 +792,7 @@ static int getint(const char *s, const char **rem, const char *e, size_t *res)
   while (sp < e && *sp && isspace((int) *sp))
     sp++;
 
-  if (!*sp || !isdigit((int) *sp))
+  if (sp >= e || !isdigit((int) *sp))
     return 0;
 
   *res = 0;
@@ -763,27 +806,41 @@ static int getint(const char *s, const char **rem, const char *e, size_t *res)
   return 1;
 }
 
-static int loadrule(const char *line, const char *e,
-                    struct nonogram_rule *rule)
+/* Is the line a rule, and how long? */
+static int ruleline(const char *line, const char *e, size_t *lenp)
 {
   const char *p = line;
-  size_t i = 0;
   size_t tmp;
 
-  rule->len = 0;
-
+  *lenp = 0;
   while (skipndigit(&p, e)) {
     const char *q;
     if (!getint(p, &q, e, &tmp) || tmp == 0)
       break;
     p = q;
-    rule->len++;
+    ++*lenp;
   }
-  if (rule->len == 0 && !isdigit((int) *p))
+  return *lenp > 0 || (p < e && isdigit((int) *p));
+}
+
+/* Return 1 if a rule was loaded, 0 if the line isn't one, or -1 if
+   out of memory. */
+static int loadrule(const char *line, const char *e,
+                    struct nonogram_rule *rule)
+{
+  const char *p = line;
+  size_t i = 0;
+  size_t tmp;
+
+  if (!ruleline(line, e, &rule->len))
     return 0;
 
   rule->cap = rule->len;
   rule->val = malloc(rule->cap * sizeof *rule->val);
+  if (!rule->val && rule->cap > 0) {
+    rule->len = rule->cap = 0;
+    return -1;
+  }
   p = line;
   while (i < rule->len && skipndigit(&p, e)) {
     getint(p, &p, e, &tmp);
@@ -817,11 +874,17 @@ static int scanline(nonogram_puzzle *p, struct linectxt *ctxt,
     ctxt->nowidth = false;
     if (!getint(cmdend, NULL, end, &p->width) || p->width  < 1) {
       if (ef) (*ef)(eh, "%3d: %-.*s needs positive integer\n",
-                    ctxt->lineno, cmdend - cmd, cmd);
+                    (int) ctxt->lineno, (int) (cmdend - cmd), cmd);
+      p->width = 0;
       return 0;
     }
     p->width_cap = p->width;
-    p->col = malloc(p->width * sizeof *p->col);
+    if (p->width > SIZE_MAX / sizeof *p->col ||
+        !(p->col = malloc(p->width * sizeof *p->col))) {
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt->lineno);
+      p->width = 0;
+      return 0;
+    }
     for (ctxt->colno = 0; ctxt->colno < p->width; ctxt->colno++) {
       p->col[ctxt->colno].len = 0;
       p->col[ctxt->colno].val = NULL;
@@ -836,11 +899,17 @@ static int scanline(nonogram_puzzle *p, struct linectxt *ctxt,
     ctxt->noheight = false;
     if (!getint(cmdend, NULL, end, &p->height) || p->height < 1) {
       if (ef) (*ef)(eh, "%3d: %-.*s needs non-negative integer\n",
-                    ctxt->lineno, cmdend - cmd, cmd);
+                    (int) ctxt->lineno, (int) (cmdend - cmd), cmd);
+      p->height = 0;
       return 0;
     }
     p->height_cap = p->height;
-    p->row = malloc(p->height * sizeof *p->row);
+    if (p->height > SIZE_MAX / sizeof *p->row ||
+        !(p->row = malloc(p->height * sizeof *p->row))) {
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt->lineno);
+      p->height = 0;
+      return 0;
+    }
     for (ctxt->rowno = 0; ctxt->rowno < p->height; ctxt->rowno++) {
       p->row[ctxt->rowno].len = 0;
       p->row[ctxt->rowno].val = NULL;
@@ -887,29 +956,132 @@ static int scanline(nonogram_puzzle *p, struct linectxt *ctxt,
     char *value = gettitle(cmdend, end);
     int len = cmdend - cmd;
     char *name = malloc(len + 1);
-    memcpy(name, cmd, len);
-    name[len] = '\0';
-    nonogram_setnote(p, name, value);
+    int ok = value && name;
+    if (ok) {
+      memcpy(name, cmd, len);
+      name[len] = '\0';
+      ok = nonogram_setnote(p, name, value) == 0;
+    }
     free(value);
     free(name);
+    if (!ok) {
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt->lineno);
+      return 0;
+    }
   } else if (ctxt->onrows) {
     if (ctxt->rowno >= p->height) {
       if (ef) (*ef)(eh, "%3d: too many rows\n", (int) ctxt->lineno);
       return 0;
     }
-    if (loadrule(line, end, &p->row[ctxt->rowno]))
+    switch (loadrule(line, end, &p->row[ctxt->rowno])) {
+    case -1:
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt->lineno);
+      return 0;
+    case 1:
       ctxt->rowno++;
+      break;
+    }
   } else if (ctxt->oncolumns) {
     if (ctxt->colno >= p->width) {
       if (ef) (*ef)(eh, "%3d: too many columns\n", (int) ctxt->lineno);
       return 0;
     }
-    if (loadrule(line, end, &p->col[ctxt->colno]))
+    switch (loadrule(line, end, &p->col[ctxt->colno])) {
+    case -1:
+      if (ef) (*ef)(eh, "%3d: out of memory\n", (int) ctxt->lineno);
+      return 0;
+    case 1:
       ctxt->colno++;
+      break;
+    }
   }
   return 1;
 }
 
+/* Follow a line as scanline would, but only to count rows and
+   columns, so keep the two in step. */
+static int skimline(struct linectxt *ctxt, size_t *width, size_t *height,
+                    const char *line, const char *end)
+{
+  const char *cmd;
+  const char *cmdend;
+  size_t tmp;
+
+  if (!getword(line, end, &cmd, &cmdend))
+    return 1;
+  if (*cmd == '#')
+    return 1;
+
+  if (matchword(cmd, cmdend, "width")) {
+  reading_width:
+    if (!ctxt->nowidth)
+      return 0;
+    ctxt->nowidth = false;
+    if (!getint(cmdend, NULL, end, width) || *width < 1)
+      return 0;
+    ctxt->colno = 0;
+  } else if (matchword(cmd, cmdend, "height")) {
+  reading_height:
+    if (!ctxt->noheight)
+      return 0;
+    ctxt->noheight = false;
+    if (!getint(cmdend, NULL, end, height) || *height < 1)
+      return 0;
+    ctxt->rowno = 0;
+  } else if (matchword(cmd, cmdend, "rows")) {
+    if (getint(cmdend, NULL, end, &tmp) && tmp > 0)
+      goto reading_height;
+    if (ctxt->noheight)
+      return 0;
+    ctxt->onrows = true;
+    ctxt->oncolumns = false;
+  } else if (matchword(cmd, cmdend, "columns")) {
+    if (getint(cmdend, NULL, end, &tmp) && tmp > 0)
+      goto reading_width;
+    if (ctxt->nowidth)
+      return 0;
+    ctxt->oncolumns = true;
+    ctxt->onrows = false;
+  } else if (matchword(cmd, cmdend, "maxrule")) {
+    if (!ctxt->nomaxrule)
+      return 0;
+    ctxt->nomaxrule = false;
+    if (getint(cmdend, NULL, end, &ctxt->maxrule) && ctxt->maxrule < 1)
+      return 0;
+  } else if (isalpha((int) *cmd)) {
+    /* a note */
+  } else if (ctxt->onrows) {
+    if (ctxt->rowno >= *height)
+      return 0;
+    if (ruleline(line, end, &tmp))
+      ctxt->rowno++;
+  } else if (ctxt->oncolumns) {
+    if (ctxt->colno >= *width)
+      return 0;
+    if (ruleline(line, end, &tmp))
+      ctxt->colno++;
+  }
+  return 1;
+}
+
+int nonogram_skippuzzle(const char **s, const char *e)
+{
+  struct linectxt ctxt;
+  size_t width = 0, height = 0;
+  const char *line, *end;
+
+  ctxt.nowidth = ctxt.noheight = ctxt.nomaxrule = true;
+  ctxt.onrows = ctxt.oncolumns = false;
+  ctxt.rowno = ctxt.colno = 0;
+
+  while ((ctxt.noheight || ctxt.rowno < height) ||
+         (ctxt.nowidth || ctxt.colno < width))
+    if (!mygetline(s, e, &line, &end) ||
+        !skimline(&ctxt, &width, &height, line, end))
+      return -1;
+  return 0;
+}
+
 int nonogram_comparepuzzles(const nonogram_puzzle *p1,
                             const nonogram_puzzle *p2)
 {
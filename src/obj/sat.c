@@ -0,0 +1,856 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Once the line solvers stall, the rest of the puzzle can be handed
+   to a small CDCL SAT engine instead of being guessed at.  Each cell
+   is a variable, true if solid.  Each block of each line has a
+   variable for every place it could start, and another for every
+   place it could have started at or before, which keeps 'exactly
+   one start' to a few clauses per place, and makes the order of
+   blocks easy to express.  Cells already known become unit clauses.
+
+   The engine watches two literals per clause, learns a clause at the
+   first unique implication point of each conflict, picks variables
+   by activity with saved phases, and restarts on the Luby sequence,
+   dropping less useful learned clauses as it does.  Each model
+   found is blocked by a clause negating the decisions that led to
+   it, so the engine can go on to find the next. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+/* Literal 2v is variable v; 2v+1 is its negation. */
+typedef size_t lit;
+#define VAR(L) ((L) >> 1)
+#define NEG(L) ((L) ^ 1)
+#define POS(V) ((V) << 1)
+
+#define NONE SIZE_MAX
+
+/* values of variables */
+#define F 0
+#define T 1
+#define U 2
+
+/* conflicts between restarts, times the Luby sequence */
+#define RESTART_UNIT 100
+
+/* conflicts per call of solve before asking whether to go on */
+#define BUDGET 64
+
+struct watch {
+  size_t cref;
+  lit blocker;
+};
+
+struct watches {
+  struct watch *w;
+  size_t n, cap;
+};
+
+/* A clause in the arena is its size, then its LBD and whether it is
+   learned, then its literals. */
+#define CSIZE(E,R) ((E)->arena[R])
+#define CMETA(E,R) ((E)->arena[(R) + 1])
+#define CLITS(E,R) ((E)->arena + (R) + 2)
+#define LEARNT 1
+#define DELETED 2
+#define LBDSHIFT 2
+
+struct engine {
+  size_t vars;
+  unsigned char *val, *phase, *seen;
+  unsigned *level;
+  size_t *reason;
+
+  double *act, inc;
+  size_t *heap, *heappos, heaplen;
+
+  lit *trail;
+  size_t traillen, qhead;
+  size_t *lim;
+  unsigned levels;
+
+  struct watches *watch;
+  size_t *arena, arenalen, arenacap;
+  size_t *learnt, learnts, learntcap, maxlearnts;
+
+  lit *tmp;
+  unsigned *stamp, stampgen;
+
+  unsigned long conflicts, nextrestart, restarts;
+  int unsat, failed;
+};
+
+struct nonogram_sat {
+  struct engine e;
+
+  /* cells unknown when handed over, and whether they hold a model */
+  size_t *unknown, unknowns;
+  int shown;
+};
+
+#define litval(E,L) \
+  ((E)->val[VAR(L)] == U ? U : (unsigned) ((E)->val[VAR(L)] ^ ((L) & 1)))
+
+/* the heap of unassigned variables, most active first */
+
+static void heapup(struct engine *e, size_t i)
+{
+  size_t v = e->heap[i];
+  while (i > 0) {
+    size_t p = (i - 1) / 2;
+    if (e->act[e->heap[p]] >= e->act[v])
+      break;
+    e->heap[i] = e->heap[p];
+    e->heappos[e->heap[i]] = i;
+    i = p;
+  }
+  e->heap[i] = v;
+  e->heappos[v] = i;
+}
+
+static void heapdown(struct engine *e, size_t i)
+{
+  size_t v = e->heap[i];
+  for (;;) {
+    size_t ch = 2 * i + 1;
+    if (ch >= e->heaplen)
+      break;
+    if (ch + 1 < e->heaplen && e->act[e->heap[ch + 1]] > e->act[e->heap[ch]])
+      ch++;
+    if (e->act[e->heap[ch]] <= e->act[v])
+      break;
+    e->heap[i] = e->heap[ch];
+    e->heappos[e->heap[i]] = i;
+    i = ch;
+  }
+  e->heap[i] = v;
+  e->heappos[v] = i;
+}
+
+static void heapinsert(struct engine *e, size_t v)
+{
+  if (e->heappos[v] != NONE)
+    return;
+  e->heap[e->heaplen] = v;
+  heapup(e, e->heaplen++);
+}
+
+static size_t heappop(struct engine *e)
+{
+  size_t v = e->heap[0];
+  e->heappos[v] = NONE;
+  if (--e->heaplen > 0) {
+    e->heap[0] = e->heap[e->heaplen];
+    heapdown(e, 0);
+  }
+  return v;
+}
+
+static void bump(struct engine *e, size_t v)
+{
+  if ((e->act[v] += e->inc) > 1e100) {
+    for (size_t i = 0; i < e->vars; i++)
+      e->act[i] *= 1e-100;
+    e->inc *= 1e-100;
+  }
+  if (e->heappos[v] != NONE)
+    heapup(e, e->heappos[v]);
+}
+
+static void addwatch(struct engine *e, lit l, size_t cref, lit blocker)
+{
+  struct watches *ws = &e->watch[l];
+  if (ws->n == ws->cap) {
+    size_t cap = ws->cap ? ws->cap * 2 : 4;
+    struct watch *tmp = realloc(ws->w, cap * sizeof *tmp);
+    if (!tmp) {
+      e->failed = true;
+      return;
+    }
+    ws->w = tmp;
+    ws->cap = cap;
+  }
+  ws->w[ws->n].cref = cref;
+  ws->w[ws->n].blocker = blocker;
+  ws->n++;
+}
+
+static void assign(struct engine *e, lit l, size_t reason)
+{
+  const size_t v = VAR(l);
+  e->val[v] = !(l & 1);
+  e->level[v] = e->levels;
+  e->reason[v] = reason;
+  e->trail[e->traillen++] = l;
+}
+
+static void backtrack(struct engine *e, unsigned lvl)
+{
+  if (e->levels <= lvl)
+    return;
+  for (size_t i = e->traillen; i-- > e->lim[lvl]; ) {
+    const size_t v = VAR(e->trail[i]);
+    e->phase[v] = e->val[v];
+    e->val[v] = U;
+    heapinsert(e, v);
+  }
+  e->traillen = e->qhead = e->lim[lvl];
+  e->levels = lvl;
+}
+
+/* Store a clause of at least two literals, watching the first two. */
+static size_t store(struct engine *e, const lit *lits, size_t n,
+                    int learnt, unsigned lbd)
+{
+  if (e->arenalen + n + 2 > e->arenacap) {
+    size_t cap = e->arenacap ? e->arenacap : 1024;
+    while (cap < e->arenalen + n + 2)
+      cap *= 2;
+    size_t *tmp = realloc(e->arena, cap * sizeof *tmp);
+    if (!tmp) {
+      e->failed = true;
+      return NONE;
+    }
+    e->arena = tmp;
+    e->arenacap = cap;
+  }
+  const size_t cref = e->arenalen;
+  CSIZE(e, cref) = n;
+  CMETA(e, cref) = (learnt ? LEARNT : 0) | (size_t) lbd << LBDSHIFT;
+  memcpy(CLITS(e, cref), lits, n * sizeof *lits);
+  e->arenalen += n + 2;
+  addwatch(e, NEG(lits[0]), cref, lits[1]);
+  addwatch(e, NEG(lits[1]), cref, lits[0]);
+
+  if (learnt) {
+    if (e->learnts == e->learntcap) {
+      size_t cap = e->learntcap ? e->learntcap * 2 : 256;
+      size_t *tmp = realloc(e->learnt, cap * sizeof *tmp);
+      if (!tmp) {
+        e->failed = true;
+        return cref;
+      }
+      e->learnt = tmp;
+      e->learntcap = cap;
+    }
+    e->learnt[e->learnts++] = cref;
+  }
+  return cref;
+}
+
+/* Add a clause at level 0, leaving out literals already false. */
+static void addclause(struct engine *e, lit *lits, size_t n)
+{
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++)
+    switch (litval(e, lits[i])) {
+    case T:
+      return;
+    case U:
+      lits[k++] = lits[i];
+      break;
+    }
+  if (k == 0)
+    e->unsat = true;
+  else if (k == 1)
+    assign(e, lits[0], NONE);
+  else
+    store(e, lits, k, false, 0);
+}
+
+/* Watch lists are indexed by the negation of the watched literal, so
+   the list of a literal just made true holds the clauses to visit.
+   Returns the clause in conflict, or NONE. */
+static size_t propagate(struct engine *e)
+{
+  while (e->qhead < e->traillen) {
+    const lit p = e->trail[e->qhead++];
+    const lit fl = NEG(p);
+    struct watches *ws = &e->watch[p];
+    size_t i = 0, j = 0;
+
+    while (i < ws->n) {
+      struct watch w = ws->w[i++];
+      if (litval(e, w.blocker) == T) {
+        ws->w[j++] = w;
+        continue;
+      }
+
+      lit *c = CLITS(e, w.cref);
+      const size_t n = CSIZE(e, w.cref);
+      if (c[0] == fl)
+        c[0] = c[1], c[1] = fl;
+      const lit first = c[0];
+      w.blocker = first;
+      if (litval(e, first) == T) {
+        ws->w[j++] = w;
+        continue;
+      }
+
+      size_t k;
+      for (k = 2; k < n; k++)
+        if (litval(e, c[k]) != F) {
+          c[1] = c[k], c[k] = fl;
+          addwatch(e, NEG(c[1]), w.cref, first);
+          break;
+        }
+      if (k < n)
+        continue;
+
+      ws->w[j++] = w;
+      if (litval(e, first) == F) {
+        while (i < ws->n)
+          ws->w[j++] = ws->w[i++];
+        ws->n = j;
+        e->qhead = e->traillen;
+        return w.cref;
+      }
+      assign(e, first, w.cref);
+    }
+    ws->n = j;
+  }
+  return NONE;
+}
+
+/* Could a literal of the learned clause be left out, because its
+   reason is already covered? */
+static int redundant(struct engine *e, lit l)
+{
+  const size_t r = e->reason[VAR(l)];
+  if (r == NONE)
+    return false;
+  const lit *c = CLITS(e, r);
+  for (size_t k = 1; k < CSIZE(e, r); k++)
+    if (!e->seen[VAR(c[k])] && e->level[VAR(c[k])] > 0)
+      return false;
+  return true;
+}
+
+/* Learn a clause from a conflict, back-track to where it becomes
+   unit, and assert it. */
+static void analyze(struct engine *e, size_t confl)
+{
+  lit *out = e->tmp;
+  size_t n = 1, paths = 0, idx = e->traillen;
+  lit p = NONE;
+
+  do {
+    const lit *c = CLITS(e, confl);
+    for (size_t k = p == NONE ? 0 : 1; k < CSIZE(e, confl); k++) {
+      const size_t v = VAR(c[k]);
+      if (e->seen[v] || e->level[v] == 0)
+        continue;
+      bump(e, v);
+      e->seen[v] = true;
+      if (e->level[v] >= e->levels)
+        paths++;
+      else
+        out[n++] = c[k];
+    }
+    while (!e->seen[VAR(e->trail[--idx])])
+      ;
+    p = e->trail[idx];
+    confl = e->reason[VAR(p)];
+    e->seen[VAR(p)] = false;
+  } while (--paths > 0);
+  out[0] = NEG(p);
+
+  /* Drop literals implied by the others, and forget what was
+     seen. */
+  for (size_t i = 1; i < n; i++)
+    if (redundant(e, out[i]))
+      e->seen[VAR(out[i])] = 2;
+  size_t k = 1;
+  for (size_t i = 1; i < n; i++) {
+    const size_t v = VAR(out[i]);
+    if (e->seen[v] == 1)
+      out[k++] = out[i];
+    e->seen[v] = false;
+  }
+  n = k;
+
+  /* Find the level to go back to, and the number of levels
+     involved. */
+  unsigned back = 0, lbd = 0;
+  size_t at = 1;
+  if (++e->stampgen == 0) {
+    memset(e->stamp, 0, (e->vars + 1) * sizeof *e->stamp);
+    e->stampgen = 1;
+  }
+  for (size_t i = 0; i < n; i++) {
+    const unsigned l = e->level[VAR(out[i])];
+    if (e->stamp[l] != e->stampgen)
+      e->stamp[l] = e->stampgen, lbd++;
+    if (i > 0 && l > back)
+      back = l, at = i;
+  }
+  if (n > 1) {
+    lit t = out[1];
+    out[1] = out[at], out[at] = t;
+  }
+
+  backtrack(e, back);
+  if (n == 1) {
+    assign(e, out[0], NONE);
+  } else {
+    size_t cref = store(e, out, n, true, lbd);
+    if (cref != NONE)
+      assign(e, out[0], cref);
+  }
+  e->inc /= 0.95;
+}
+
+static unsigned long luby(unsigned long i)
+{
+  unsigned long size = 1, seq = 0;
+  while (size < i + 1)
+    seq++, size = 2 * size + 1;
+  while (size - 1 != i) {
+    size = (size - 1) >> 1;
+    seq--;
+    i %= size;
+  }
+  return 1ul << seq;
+}
+
+/* LBDs above this are counted together when reducing. */
+#define MAXLBD 64
+
+/* At level 0, drop the worse half of the learned clauses, and those
+   already satisfied, and rewatch what's left. */
+static void reduce(struct engine *e)
+{
+  /* Find the LBD above which clauses go, and how many of those at it
+     go too, oldest first.  Those of LBD 2 or less stay. */
+  size_t count[MAXLBD + 1] = { 0 };
+  for (size_t i = 0; i < e->learnts; i++) {
+    size_t lbd = CMETA(e, e->learnt[i]) >> LBDSHIFT;
+    count[lbd < MAXLBD ? lbd : MAXLBD]++;
+  }
+  size_t cut = MAXLBD, quota = e->learnts / 2;
+  while (cut > 2 && quota > count[cut])
+    quota -= count[cut--];
+  if (cut <= 2)
+    quota = 0;
+  for (size_t i = 0; i < e->learnts; i++) {
+    size_t lbd = CMETA(e, e->learnt[i]) >> LBDSHIFT;
+    if (lbd > MAXLBD)
+      lbd = MAXLBD;
+    if (lbd > cut || (lbd == cut && quota > 0 && quota--))
+      CMETA(e, e->learnt[i]) |= DELETED;
+  }
+
+  for (size_t v = 0; v < e->vars; v++)
+    e->reason[v] = NONE;
+  for (size_t l = 0; l < 2 * e->vars; l++)
+    e->watch[l].n = 0;
+
+  size_t from = 0, to = 0;
+  e->learnts = 0;
+  while (from < e->arenalen) {
+    const size_t n = CSIZE(e, from), meta = CMETA(e, from);
+    const lit *c = CLITS(e, from);
+    size_t k = 0;
+    int sat = false;
+
+    if (!(meta & DELETED))
+      for (size_t i = 0; i < n && !sat; i++)
+        switch (litval(e, c[i])) {
+        case T:
+          sat = true;
+          break;
+        case U:
+          e->arena[to + 2 + k++] = c[i];
+          break;
+        }
+    from += n + 2;
+    if ((meta & DELETED) || sat)
+      continue;
+
+    /* Fully propagated, so at least two literals remain. */
+    CSIZE(e, to) = k;
+    CMETA(e, to) = meta;
+    addwatch(e, NEG(CLITS(e, to)[0]), to, CLITS(e, to)[1]);
+    addwatch(e, NEG(CLITS(e, to)[1]), to, CLITS(e, to)[0]);
+    if (meta & LEARNT)
+      e->learnt[e->learnts++] = to;
+    to += k + 2;
+  }
+  e->arenalen = to;
+}
+
+/* Search for at most 'budget' conflicts.  Returns 1 with a model, 0
+   if there are no more, or -1 if the budget ran out. */
+static int solve(struct engine *e, unsigned long budget)
+{
+  if (e->unsat)
+    return 0;
+
+  for (;;) {
+    const size_t confl = propagate(e);
+    if (confl != NONE) {
+      e->conflicts++;
+      if (e->levels == 0) {
+        e->unsat = true;
+        return 0;
+      }
+      analyze(e, confl);
+      if (--budget == 0)
+        return -1;
+      continue;
+    }
+
+    if (e->conflicts >= e->nextrestart) {
+      backtrack(e, 0);
+      e->nextrestart = e->conflicts + RESTART_UNIT * luby(e->restarts++);
+      if (e->learnts > e->maxlearnts) {
+        reduce(e);
+        e->maxlearnts += e->maxlearnts / 10;
+      }
+      continue;
+    }
+
+    size_t v = NONE;
+    while (e->heaplen > 0)
+      if (e->val[v = heappop(e)] == U)
+        break;
+      else
+        v = NONE;
+    if (v == NONE)
+      return 1;
+
+    e->lim[e->levels++] = e->traillen;
+    assign(e, POS(v) | !e->phase[v], NONE);
+  }
+}
+
+/* Exclude the model just found, which follows from its decisions. */
+static void block(struct engine *e)
+{
+  lit *c = e->tmp;
+  for (unsigned l = 0; l < e->levels; l++)
+    c[l] = NEG(e->trail[e->lim[l]]);
+  const size_t n = e->levels;
+  backtrack(e, 0);
+  addclause(e, c, n);
+}
+
+static void term(struct engine *e)
+{
+  if (e->watch)
+    for (size_t l = 0; l < 2 * e->vars; l++)
+      free(e->watch[l].w);
+  free(e->watch);
+  free(e->val);
+  free(e->phase);
+  free(e->seen);
+  free(e->level);
+  free(e->reason);
+  free(e->act);
+  free(e->heap);
+  free(e->heappos);
+  free(e->trail);
+  free(e->lim);
+  free(e->arena);
+  free(e->learnt);
+  free(e->tmp);
+  free(e->stamp);
+}
+
+static int init(struct engine *e, size_t vars)
+{
+  memset(e, 0, sizeof *e);
+  e->vars = vars;
+  e->val = malloc(vars);
+  e->phase = calloc(vars, 1);
+  e->seen = calloc(vars, 1);
+  e->level = malloc(vars * sizeof *e->level);
+  e->reason = malloc(vars * sizeof *e->reason);
+  e->act = calloc(vars, sizeof *e->act);
+  e->heap = malloc(vars * sizeof *e->heap);
+  e->heappos = malloc(vars * sizeof *e->heappos);
+  e->trail = malloc(vars * sizeof *e->trail);
+  e->lim = malloc((vars + 1) * sizeof *e->lim);
+  e->watch = calloc(2 * vars, sizeof *e->watch);
+  e->tmp = malloc((vars + 1) * sizeof *e->tmp);
+  e->stamp = calloc(vars + 1, sizeof *e->stamp);
+  if (!e->val || !e->phase || !e->seen || !e->level || !e->reason ||
+      !e->act || !e->heap || !e->heappos || !e->trail || !e->lim ||
+      !e->watch || !e->tmp || !e->stamp)
+    return -1;
+  memset(e->val, U, vars);
+  e->inc = 1.0;
+  for (size_t v = 0; v < vars; v++) {
+    e->reason[v] = NONE;
+    e->heap[v] = v;
+    e->heappos[v] = v;
+  }
+  e->heaplen = vars;
+  e->nextrestart = RESTART_UNIT;
+  e->maxlearnts = 2000;
+  return 0;
+}
+
+/* Where block j of a line of 'len' cells may start, given the rule
+   'r' of 'k' blocks, is [lo, hi]. */
+static int range(const nonogram_sizetype *r, size_t k, size_t len,
+                 size_t j, size_t *lo, size_t *hi)
+{
+  size_t before = 0, after = 0;
+  for (size_t t = 0; t < j; t++)
+    before += r[t] + 1;
+  for (size_t t = j; t < k; t++)
+    after += r[t] + 1;
+  after--;
+  if (before + after > len)
+    return false;
+  *lo = before;
+  *hi = len - after;
+  return true;
+}
+
+static size_t countvars(const struct nonogram_rule *rule, size_t len)
+{
+  size_t n = 0, lo, hi;
+  for (size_t j = 0; j < rule->len; j++)
+    if (range(rule->val, rule->len, len, j, &lo, &hi))
+      n += 2 * (hi - lo + 1);
+  return n;
+}
+
+/* Encode a line whose cell i is variable base + i * step, using
+   variables from *next for its blocks. */
+static void encode(struct engine *e, const struct nonogram_rule *rule,
+                   size_t len, size_t base, size_t step,
+                   size_t *next, lit *c)
+{
+  const size_t k = rule->len;
+  const nonogram_sizetype *r = rule->val;
+  size_t first = *next;
+
+#define CELL(I) POS(base + (I) * step)
+#define START(J,P) POS(sv[J] + ((P) - lo[J]) * 2)
+#define BY(J,P) POS(sv[J] + ((P) - lo[J]) * 2 + 1)
+
+  if (k == 0) {
+    for (size_t i = 0; i < len; i++) {
+      c[0] = NEG(CELL(i));
+      addclause(e, c, 1);
+    }
+    return;
+  }
+
+  size_t lo[k], hi[k], sv[k];
+  for (size_t j = 0; j < k; j++) {
+    if (!range(r, k, len, j, &lo[j], &hi[j])) {
+      e->unsat = true;
+      return;
+    }
+    sv[j] = first;
+    first += 2 * (hi[j] - lo[j] + 1);
+  }
+  *next = first;
+
+  for (size_t j = 0; j < k; j++) {
+    /* The block starts somewhere... */
+    size_t n = 0;
+    for (size_t p = lo[j]; p <= hi[j]; p++)
+      c[n++] = START(j, p);
+    addclause(e, c, n);
+
+    for (size_t p = lo[j]; p <= hi[j]; p++) {
+      /* ...and BY(j,p) says whether it has by p, so only once. */
+      c[0] = NEG(START(j, p)), c[1] = BY(j, p);
+      addclause(e, c, 2);
+      if (p > lo[j]) {
+        c[0] = NEG(BY(j, p - 1)), c[1] = BY(j, p);
+        addclause(e, c, 2);
+        c[0] = NEG(BY(j, p - 1)), c[1] = NEG(START(j, p));
+        addclause(e, c, 2);
+        c[0] = NEG(BY(j, p)), c[1] = BY(j, p - 1), c[2] = START(j, p);
+        addclause(e, c, 3);
+      } else {
+        c[0] = NEG(BY(j, p)), c[1] = START(j, p);
+        addclause(e, c, 2);
+      }
+
+      /* The block covers its cells, with a dot either side. */
+      for (size_t i = p; i < p + r[j]; i++) {
+        c[0] = NEG(START(j, p)), c[1] = CELL(i);
+        addclause(e, c, 2);
+      }
+      if (p > 0) {
+        c[0] = NEG(START(j, p)), c[1] = NEG(CELL(p - 1));
+        addclause(e, c, 2);
+      }
+      if (p + r[j] < len) {
+        c[0] = NEG(START(j, p)), c[1] = NEG(CELL(p + r[j]));
+        addclause(e, c, 2);
+      }
+
+      /* The previous block has started early enough. */
+      if (j > 0 && p - r[j - 1] - 1 < hi[j - 1]) {
+        c[0] = NEG(START(j, p)), c[1] = BY(j - 1, p - r[j - 1] - 1);
+        addclause(e, c, 2);
+      }
+    }
+  }
+
+  /* A solid cell is covered by some block. */
+  for (size_t i = 0; i < len; i++) {
+    size_t n = 0;
+    c[n++] = NEG(CELL(i));
+    for (size_t j = 0; j < k; j++)
+      for (size_t p = lo[j]; p <= hi[j] && p <= i; p++)
+        if (i < p + r[j])
+          c[n++] = START(j, p);
+    addclause(e, c, n);
+  }
+
+#undef CELL
+#undef START
+#undef BY
+}
+
+void nonogram_freesat(struct nonogram_sat *s)
+{
+  if (!s) return;
+  term(&s->e);
+  free(s->unknown);
+  free(s);
+}
+
+struct nonogram_sat *nonogram_makesat(const nonogram_solver *c)
+{
+  const nonogram_puzzle *puzzle = c->puzzle;
+  const size_t width = puzzle->width, height = puzzle->height;
+  const size_t cells = width * height;
+
+  size_t vars = cells;
+  for (size_t y = 0; y < height; y++)
+    vars += countvars(&puzzle->row[y], width);
+  for (size_t x = 0; x < width; x++)
+    vars += countvars(&puzzle->col[x], height);
+
+  struct nonogram_sat *s = malloc(sizeof *s);
+  if (!s) return NULL;
+  s->unknown = malloc(cells * sizeof *s->unknown);
+  s->unknowns = 0;
+  s->shown = false;
+  if (init(&s->e, vars) < 0 || !s->unknown) {
+    nonogram_freesat(s);
+    return NULL;
+  }
+
+  /* What's known already is given. */
+  lit *tmp = s->e.tmp;
+  for (size_t i = 0; i < cells; i++)
+    switch (c->grid[i]) {
+    case nonogram_SOLID:
+      tmp[0] = POS(i);
+      addclause(&s->e, tmp, 1);
+      break;
+    case nonogram_DOT:
+      tmp[0] = NEG(POS(i));
+      addclause(&s->e, tmp, 1);
+      break;
+    default:
+      s->unknown[s->unknowns++] = i;
+      break;
+    }
+
+  size_t next = cells;
+  for (size_t y = 0; y < height; y++)
+    encode(&s->e, &puzzle->row[y], width, y * width, 1, &next, tmp);
+  for (size_t x = 0; x < width; x++)
+    encode(&s->e, &puzzle->col[x], height, x, width, &next, tmp);
+
+  if (s->e.failed) {
+    nonogram_freesat(s);
+    return NULL;
+  }
+
+#if nonogram_LOGLEVEL > 0
+  if (c->log.file) {
+    fprintf(c->log.file, "%*sHanded %zu cells to SAT: %zu variables,"
+            " %zu literals\n", c->log.indent, "", s->unknowns, vars,
+            s->e.arenalen);
+    fflush(c->log.file);
+  }
+#endif
+  return s;
+}
+
+int nonogram_clearsat(nonogram_solver *c)
+{
+  struct nonogram_sat *s = c->sat;
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+
+  if (!s->shown)
+    return false;
+  for (size_t i = 0; i < s->unknowns; i++) {
+    const size_t cell = s->unknown[i];
+    c->grid[cell] = nonogram_BLANK;
+    c->mirror[cell / width + cell % width * height] = nonogram_BLANK;
+    nonogram_touchcell(c, cell % width, cell / width);
+  }
+  s->shown = false;
+  return true;
+}
+
+int nonogram_runsat(nonogram_solver *c, int (*test)(void *), void *data)
+{
+  struct nonogram_sat *s = c->sat;
+  struct engine *e = &s->e;
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+
+  for (;;) {
+    switch (solve(e, BUDGET)) {
+    case 1:
+      for (size_t i = 0; i < s->unknowns; i++) {
+        const size_t cell = s->unknown[i];
+        const nonogram_cell v =
+          e->val[cell] == T ? nonogram_SOLID : nonogram_DOT;
+        c->grid[cell] = v;
+        c->mirror[cell / width + cell % width * height] = v;
+        nonogram_touchcell(c, cell % width, cell / width);
+      }
+      s->shown = true;
+      block(e);
+      return e->failed ? nonogram_ERROR : nonogram_FOUND;
+
+    case 0:
+      return e->failed ? nonogram_ERROR : nonogram_FINISHED;
+    }
+    if (e->failed)
+      return nonogram_ERROR;
+    if (!(*test)(data))
+      return nonogram_UNFINISHED;
+  }
+}
@@ -0,0 +1,277 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stddef.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+/* Vector scanning is used only where we know how to ask the CPU what
+   it supports.  Define nonogram_SIMD as 0 to build without it. */
+#ifndef nonogram_SIMD
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define nonogram_SIMD 1
+#else
+#define nonogram_SIMD 0
+#endif
+#endif
+
+/* Each scanner examines cells cp[0], cp[1], ... (or cp[0], cp[-1],
+   ... for the reverse ones), and returns the offset of the first that
+   equals 'v' (find) or doesn't (skip), or 'lim' if none do. */
+typedef size_t scanproc(const nonogram_cell *cp, size_t lim, nonogram_cell v);
+
+struct scanners {
+  scanproc *find, *skip, *rfind, *rskip;
+};
+
+static size_t find_scalar(const nonogram_cell *cp, size_t lim,
+                          nonogram_cell v)
+{
+  size_t i = 0;
+  while (i < lim && cp[i] != v)
+    i++;
+  return i;
+}
+
+static size_t skip_scalar(const nonogram_cell *cp, size_t lim,
+                          nonogram_cell v)
+{
+  size_t i = 0;
+  while (i < lim && cp[i] == v)
+    i++;
+  return i;
+}
+
+static size_t rfind_scalar(const nonogram_cell *cp, size_t lim,
+                           nonogram_cell v)
+{
+  size_t i = 0;
+  while (i < lim && *(cp - i) != v)
+    i++;
+  return i;
+}
+
+static size_t rskip_scalar(const nonogram_cell *cp, size_t lim,
+                           nonogram_cell v)
+{
+  size_t i = 0;
+  while (i < lim && *(cp - i) == v)
+    i++;
+  return i;
+}
+
+static const struct scanners scalar = {
+  &find_scalar, &skip_scalar, &rfind_scalar, &rskip_scalar,
+};
+
+#if nonogram_SIMD
+#include <immintrin.h>
+
+/* In each vector, bit n of the comparison mask corresponds to the
+   n-th byte loaded.  Going forwards, we want the lowest set bit;
+   going backwards, we load the preceding bytes, so we want the
+   highest.
+
+   The AVX2 scanners finish with the SSE2 ones, so they must clear the
+   upper halves of the vector registers first.  The compiler doesn't
+   do that for us before the call, and running legacy SSE code with
+   them dirty costs far more than the scan itself. */
+
+__attribute__((target("sse2")))
+static size_t find_sse2(const nonogram_cell *cp, size_t lim,
+                        nonogram_cell v)
+{
+  const __m128i vv = _mm_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (cp + i));
+    unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, vv));
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + find_scalar(cp + i, lim - i, v);
+}
+
+__attribute__((target("sse2")))
+static size_t skip_sse2(const nonogram_cell *cp, size_t lim,
+                        nonogram_cell v)
+{
+  const __m128i vv = _mm_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (cp + i));
+    unsigned m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, vv)) & 0xffffu;
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + skip_scalar(cp + i, lim - i, v);
+}
+
+__attribute__((target("sse2")))
+static size_t rfind_sse2(const nonogram_cell *cp, size_t lim,
+                         nonogram_cell v)
+{
+  const __m128i vv = _mm_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (cp - i - 15));
+    unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, vv));
+    if (m)
+      return i + 15 - (31 - __builtin_clz(m));
+  }
+  return i + rfind_scalar(cp - i, lim - i, v);
+}
+
+__attribute__((target("sse2")))
+static size_t rskip_sse2(const nonogram_cell *cp, size_t lim,
+                         nonogram_cell v)
+{
+  const __m128i vv = _mm_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (cp - i - 15));
+    unsigned m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, vv)) & 0xffffu;
+    if (m)
+      return i + 15 - (31 - __builtin_clz(m));
+  }
+  return i + rskip_scalar(cp - i, lim - i, v);
+}
+
+static const struct scanners sse2 = {
+  &find_sse2, &skip_sse2, &rfind_sse2, &rskip_sse2,
+};
+
+__attribute__((target("avx2")))
+static size_t find_avx2(const nonogram_cell *cp, size_t lim,
+                        nonogram_cell v)
+{
+  const __m256i vv = _mm256_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 32; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (cp + i));
+    unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vv));
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  _mm256_zeroupper();
+  return i + find_sse2(cp + i, lim - i, v);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_avx2(const nonogram_cell *cp, size_t lim,
+                        nonogram_cell v)
+{
+  const __m256i vv = _mm256_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 32; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (cp + i));
+    unsigned m = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vv));
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  _mm256_zeroupper();
+  return i + skip_sse2(cp + i, lim - i, v);
+}
+
+__attribute__((target("avx2")))
+static size_t rfind_avx2(const nonogram_cell *cp, size_t lim,
+                         nonogram_cell v)
+{
+  const __m256i vv = _mm256_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 32; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (cp - i - 31));
+    unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vv));
+    if (m)
+      return i + 31 - (31 - __builtin_clz(m));
+  }
+  _mm256_zeroupper();
+  return i + rfind_sse2(cp - i, lim - i, v);
+}
+
+__attribute__((target("avx2")))
+static size_t rskip_avx2(const nonogram_cell *cp, size_t lim,
+                         nonogram_cell v)
+{
+  const __m256i vv = _mm256_set1_epi8((char) v);
+  size_t i = 0;
+  for ( ; lim - i >= 32; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (cp - i - 31));
+    unsigned m = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, vv));
+    if (m)
+      return i + 31 - (31 - __builtin_clz(m));
+  }
+  _mm256_zeroupper();
+  return i + rskip_sse2(cp - i, lim - i, v);
+}
+
+static const struct scanners avx2 = {
+  &find_avx2, &skip_avx2, &rfind_avx2, &rskip_avx2,
+};
+#endif
+
+/* Nothing is solved before the library is initialised, so the choice
+   is made then, before any solver thread can read it. */
+static const struct scanners *chosen = &scalar;
+
+#if nonogram_SIMD
+__attribute__((constructor))
+static void choose(void)
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    chosen = &avx2;
+  else if (__builtin_cpu_supports("sse2"))
+    chosen = &sse2;
+}
+#endif
+
+/* Short runs aren't worth the call. */
+#define SCAN_MIN 16
+
+size_t nonogram_findcell(const nonogram_cell *cp, ptrdiff_t step,
+                         size_t lim, nonogram_cell v)
+{
+  if (lim >= SCAN_MIN && (step == 1 || step == -1))
+    return step > 0 ?
+      (*chosen->find)(cp, lim, v) : (*chosen->rfind)(cp, lim, v);
+
+  size_t i = 0;
+  while (i < lim && *cp != v)
+    i++, cp += step;
+  return i;
+}
+
+size_t nonogram_skipcell(const nonogram_cell *cp, ptrdiff_t step,
+                         size_t lim, nonogram_cell v)
+{
+  if (lim >= SCAN_MIN && (step == 1 || step == -1))
+    return step > 0 ?
+      (*chosen->skip)(cp, lim, v) : (*chosen->rskip)(cp, lim, v);
+
+  size_t i = 0;
+  while (i < lim && *cp == v)
+    i++, cp += step;
+  return i;
+}
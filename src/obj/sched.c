@@ -0,0 +1,120 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Lines awaiting a line solver are kept in a heap, so that the next
+   can be found without scanning them all.  Rows are numbered from 0,
+   and columns follow them, matching the layout of the solver's flags
+   and attributes.  The line on top is the one that a scan of rows
+   then columns would find first with the highest flag, then the
+   highest score. */
+
+#include <stddef.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#define ABSENT ((size_t) -1)
+
+static int before(const nonogram_solver *c, size_t a, size_t b)
+{
+  if (c->rowflag[a] != c->rowflag[b])
+    return c->rowflag[a] > c->rowflag[b];
+  if (c->rowattr[a].score != c->rowattr[b].score)
+    return c->rowattr[a].score > c->rowattr[b].score;
+  return a < b;
+}
+
+static void place(nonogram_solver *c, size_t at, size_t line)
+{
+  c->heap[at] = line;
+  c->heappos[line] = at;
+}
+
+static void siftup(nonogram_solver *c, size_t at)
+{
+  size_t line = c->heap[at];
+  while (at > 0) {
+    size_t parent = (at - 1) / 2;
+    if (!before(c, line, c->heap[parent]))
+      break;
+    place(c, at, c->heap[parent]);
+    at = parent;
+  }
+  place(c, at, line);
+}
+
+static void siftdown(nonogram_solver *c, size_t at)
+{
+  size_t line = c->heap[at];
+  for (;;) {
+    size_t child = at * 2 + 1;
+    if (child >= c->heaplen)
+      break;
+    if (child + 1 < c->heaplen &&
+        before(c, c->heap[child + 1], c->heap[child]))
+      child++;
+    if (!before(c, c->heap[child], line))
+      break;
+    place(c, at, c->heap[child]);
+    at = child;
+  }
+  place(c, at, line);
+}
+
+void nonogram_resched(nonogram_solver *c, size_t line)
+{
+  size_t at = c->heappos[line];
+
+  if (!c->rowflag[line]) {
+    /* The line no longer needs solving. */
+    if (at == ABSENT)
+      return;
+    c->heappos[line] = ABSENT;
+    if (at == --c->heaplen)
+      return;
+    place(c, at, c->heap[c->heaplen]);
+  } else if (at == ABSENT) {
+    at = c->heaplen++;
+    place(c, at, line);
+  }
+
+  /* The line now at 'at' may be out of place in either direction. */
+  line = c->heap[at];
+  siftup(c, at);
+  if (c->heap[at] == line)
+    siftdown(c, at);
+}
+
+void nonogram_rebuildsched(nonogram_solver *c)
+{
+  const size_t lines = c->puzzle->width + c->puzzle->height;
+
+  c->heaplen = 0;
+  for (size_t i = 0; i < lines; i++)
+    if (c->rowflag[i])
+      place(c, c->heaplen++, i);
+    else
+      c->heappos[i] = ABSENT;
+  for (size_t i = c->heaplen / 2; i > 0; i--)
+    siftdown(c, i - 1);
+}
@@ -0,0 +1,474 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Parallel bifurcation search.  Each worker has its own solver, and
+   each guess made by a worker becomes a task holding a snapshot of
+   the whole grid, placed at the bottom of the worker's own deque.  A
+   worker takes its next task from the bottom of its own deque, so it
+   proceeds depth-first as the sequential solver does, but an idle
+   worker steals from the top of another's, taking the oldest and
+   usually largest piece of work.  Guesses are rare compared with line
+   solving, so all deques share one lock. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+#if nonogram_THREADS
+#include <pthread.h>
+#endif
+
+struct task {
+  struct task *up, *down;
+  int remcells;
+  struct nonogram_rect unkarea;
+  nonogram_cell *grid;
+  nonogram_lineattr *attr; /* rows then columns */
+  nonogram_level *flag; /* rows then columns */
+};
+
+struct search;
+
+struct nonogram_worker {
+  struct search *search;
+  nonogram_solver solver;
+  nonogram_cell *grid;
+  struct task *top, *bottom;
+};
+
+struct search {
+  nonogram_solver *master;
+  int (*more)(void *);
+  void *data;
+
+#if nonogram_THREADS
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+#endif
+
+  struct nonogram_worker *worker;
+  unsigned workers;
+
+  /* Search is over when no worker is busy and no task is queued. */
+  unsigned busy;
+  unsigned long queued;
+  unsigned done : 1, stop : 1, failed : 1;
+};
+
+#if nonogram_THREADS
+#define LOCK(S) pthread_mutex_lock(&(S)->lock)
+#define UNLOCK(S) pthread_mutex_unlock(&(S)->lock)
+#define WAIT(S) pthread_cond_wait(&(S)->ready, &(S)->lock)
+#define WAKE(S) pthread_cond_broadcast(&(S)->ready)
+#else
+#define LOCK(S) ((void) 0)
+#define UNLOCK(S) ((void) 0)
+#define WAIT(S) ((void) 0)
+#define WAKE(S) ((void) 0)
+#endif
+
+static struct task *maketask(const nonogram_solver *c)
+{
+  const size_t cells = c->puzzle->width * c->puzzle->height;
+  const size_t lines = c->puzzle->width + c->puzzle->height;
+
+  size_t amount = sizeof(struct task);
+  size_t grid_offset = amount = align(amount, nonogram_cell);
+  amount += cells * sizeof(nonogram_cell);
+  size_t attr_offset = amount = align(amount, nonogram_lineattr);
+  amount += lines * sizeof(nonogram_lineattr);
+  size_t flag_offset = amount = align(amount, nonogram_level);
+  amount += lines * sizeof(nonogram_level);
+
+  char *mem = malloc(amount);
+  if (!mem)
+    return NULL;
+  struct task *t = (void *) mem;
+  t->grid = (void *) (mem + grid_offset);
+  t->attr = (void *) (mem + attr_offset);
+  t->flag = (void *) (mem + flag_offset);
+
+  /* The solver keeps row and column data in single blocks. */
+  memcpy(t->grid, c->grid, cells * sizeof(nonogram_cell));
+  memcpy(t->attr, c->rowattr, lines * sizeof(nonogram_lineattr));
+  memcpy(t->flag, c->rowflag, lines * sizeof(nonogram_level));
+  t->remcells = c->remcells;
+  t->unkarea = c->unkarea;
+  return t;
+}
+
+static void pushbottom(struct nonogram_worker *w, struct task *t)
+{
+  t->down = NULL;
+  t->up = w->bottom;
+  if (w->bottom)
+    w->bottom->down = t;
+  else
+    w->top = t;
+  w->bottom = t;
+}
+
+static void pushtop(struct nonogram_worker *w, struct task *t)
+{
+  t->up = NULL;
+  t->down = w->top;
+  if (w->top)
+    w->top->up = t;
+  else
+    w->bottom = t;
+  w->top = t;
+}
+
+static struct task *popbottom(struct nonogram_worker *w)
+{
+  struct task *t = w->bottom;
+  if (t) {
+    w->bottom = t->up;
+    if (w->bottom)
+      w->bottom->down = NULL;
+    else
+      w->top = NULL;
+  }
+  return t;
+}
+
+static struct task *poptop(struct nonogram_worker *w)
+{
+  struct task *t = w->top;
+  if (t) {
+    w->top = t->down;
+    if (w->top)
+      w->top->up = NULL;
+    else
+      w->bottom = NULL;
+  }
+  return t;
+}
+
+/* Called with the lock held. */
+static struct task *take(struct search *s, struct nonogram_worker *w)
+{
+  struct task *t = popbottom(w);
+  if (t)
+    return t;
+
+  /* Steal, starting with the next worker along. */
+  size_t me = w - s->worker;
+  for (unsigned i = 1; i < s->workers; i++) {
+    t = poptop(&s->worker[(me + i) % s->workers]);
+    if (t)
+      return t;
+  }
+  return NULL;
+}
+
+int nonogram_spawn(struct nonogram_worker *w, const nonogram_solver *c,
+                   const struct nonogram_point *pos)
+{
+  struct search *s = w->search;
+  struct task *t = maketask(c);
+  if (!t)
+    return -1;
+
+  /* The solver would resume this guess with the row and column
+     through it to be solved again. */
+  t->flag[pos->y] = c->levels;
+  t->flag[c->puzzle->height + pos->x] = c->levels;
+
+  LOCK(s);
+  pushbottom(w, t);
+  s->queued++;
+  WAKE(s);
+  UNLOCK(s);
+  return 0;
+}
+
+/* Set a solver's state to that of a task. */
+static void resume(nonogram_solver *c, const struct task *t)
+{
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+  const size_t lines = width + height;
+
+  memcpy(c->grid, t->grid, width * height * sizeof(nonogram_cell));
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++)
+      c->mirror[y + x * height] = c->grid[x + y * width];
+  memcpy(c->rowattr, t->attr, lines * sizeof(nonogram_lineattr));
+  memcpy(c->rowflag, t->flag, lines * sizeof(nonogram_level));
+
+  c->reminfo = 0;
+  for (size_t i = 0; i < lines; i++)
+    c->reminfo += !!c->rowflag[i];
+  c->remcells = t->remcells;
+  c->unkarea = t->unkarea;
+  c->reversed = false;
+  nonogram_touchall(c);
+  nonogram_rebuildsched(c);
+}
+
+static void present(void *vw)
+{
+  struct nonogram_worker *w = vw;
+  struct search *s = w->search;
+  nonogram_solver *m = s->master;
+  const size_t width = m->puzzle->width, height = m->puzzle->height;
+
+  LOCK(s);
+  if (!s->stop) {
+    memcpy(m->grid, w->grid, width * height * sizeof(nonogram_cell));
+    for (size_t y = 0; y < height; y++)
+      for (size_t x = 0; x < width; x++)
+        m->mirror[y + x * height] = m->grid[x + y * width];
+    nonogram_touchall(m);
+    if (m->client && m->client->present)
+      (*m->client->present)(m->client_data);
+    if (s->more && !(*s->more)(s->data)) {
+      s->stop = s->done = true;
+      WAKE(s);
+    }
+  }
+  UNLOCK(s);
+}
+
+static const struct nonogram_client client = { &present };
+
+static int always(void *data)
+{
+  UNUSED(data);
+  return true;
+}
+
+/* How many cycles a worker runs between checks for the end of the
+   search */
+#define CHECK_EVERY 64
+
+static void explore(void *vs, size_t i, unsigned thread)
+{
+  struct search *s = vs;
+  struct nonogram_worker *w = &s->worker[i];
+  UNUSED(thread);
+
+  LOCK(s);
+  for (;;) {
+    struct task *t = NULL;
+    while (!s->done && !(t = take(s, w))) {
+      if (!s->busy) {
+        s->done = true;
+        WAKE(s);
+      } else {
+        WAIT(s);
+      }
+    }
+    if (!t)
+      break;
+    s->queued--;
+    s->busy++;
+    UNLOCK(s);
+
+    resume(&w->solver, t);
+    free(t);
+
+    int rc, stop = false;
+    for (unsigned n = 1;
+         (rc = nonogram_runcycles(&w->solver, &always, NULL))
+           != nonogram_FINISHED; n++) {
+      if (rc == nonogram_ERROR) {
+        LOCK(s);
+        s->failed = s->done = true;
+        WAKE(s);
+        UNLOCK(s);
+        break;
+      }
+      if (n % CHECK_EVERY == 0) {
+        LOCK(s);
+        stop = s->done;
+        UNLOCK(s);
+        if (stop)
+          break;
+      }
+    }
+
+    LOCK(s);
+    s->busy--;
+    if (!s->busy)
+      WAKE(s);
+  }
+  UNLOCK(s);
+}
+
+static int initworker(struct nonogram_worker *w, struct search *s)
+{
+  const nonogram_solver *m = s->master;
+  nonogram_solver *c = &w->solver;
+  const size_t cells = m->puzzle->width * m->puzzle->height;
+
+  w->search = s;
+  w->top = w->bottom = NULL;
+  nonogram_initsolver(c);
+  w->grid = malloc(cells * sizeof(nonogram_cell));
+  if (!w->grid)
+    return -1;
+  nonogram_cleargrid(w->grid, m->puzzle->width, m->puzzle->height);
+
+  if (nonogram_copyconf(c, m) < 0)
+    return -1;
+  nonogram_setclient(c, &client, w);
+
+  if (nonogram_load(c, m->puzzle, w->grid, (int) cells) < 0)
+    return -1;
+  c->worker = w;
+  return 0;
+}
+
+static void termworker(struct nonogram_worker *w)
+{
+  struct task *t;
+  while ((t = popbottom(w)))
+    free(t);
+  nonogram_termsolver(&w->solver);
+  free(w->grid);
+}
+
+/* Turn the master's current state and the guesses it has pushed into
+   tasks for the first worker, with the current state at the bottom.
+   The master is left with no more work. */
+static int seed(struct search *s)
+{
+  nonogram_solver *c = s->master;
+  struct nonogram_worker *w = &s->worker[0];
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+  struct task *t;
+
+  if (c->remcells >= 0) {
+    if (!(t = maketask(c)))
+      return -1;
+    pushtop(w, t);
+    s->queued++;
+  }
+
+  /* Cells outside a pushed area were already known when it was
+     pushed, and have not changed since. */
+  for (nonogram_stack *st = c->stack; st; st = st->next) {
+    const size_t w0 = st->unkarea.min.x, h0 = st->unkarea.min.y;
+    const size_t aw = st->unkarea.max.x - w0;
+    const size_t ah = st->unkarea.max.y - h0;
+
+    /* With a trail, the master itself is taken back to each guess in
+       turn. */
+    if (c->usetrail)
+      nonogram_undotrail(c, st->trailmark);
+
+    if (!(t = maketask(c)))
+      return -1;
+    for (size_t y = 0; y < ah && !c->usetrail; y++) {
+      nonogram_cell *row = t->grid + w0 + (y + h0) * width;
+      if (c->packstack)
+        nonogram_unpackcells(row, st->grid + y * nonogram_packedsize(aw), aw);
+      else
+        memcpy(row, st->grid + y * aw, aw * sizeof(nonogram_cell));
+      t->attr[y + h0] = st->rowattr[y];
+    }
+    for (size_t x = 0; x < aw && !c->usetrail; x++)
+      t->attr[height + x + w0] = st->colattr[x];
+    memset(t->flag, 0, (width + height) * sizeof(nonogram_level));
+    t->flag[st->guesspos.y] = c->levels;
+    t->flag[height + st->guesspos.x] = c->levels;
+    t->remcells = st->remcells;
+    t->unkarea = st->unkarea;
+    pushtop(w, t);
+    s->queued++;
+  }
+
+  while (c->stack) {
+    nonogram_stack *st = c->stack;
+    c->stack = st->next;
+    nonogram_putframe(c, st);
+  }
+  c->remcells = -1;
+  c->reminfo = 0;
+  return 0;
+}
+
+int nonogram_runsearch(nonogram_solver *c, unsigned threads,
+                       int (*more)(void *), void *data)
+{
+  if (!c->puzzle)
+    return nonogram_UNLOADED;
+
+  /* Finish any line in progress. */
+  while (c->status != nonogram_EMPTY)
+    nonogram_runcycles(c, &always, NULL);
+
+  /* A SAT search already under way is abandoned, as workers guess. */
+  if (c->sat) {
+    nonogram_clearsat(c);
+    nonogram_freesat(c->sat), c->sat = NULL;
+  }
+
+  struct nonogram_pool *pool = threads > 1 ? nonogram_makepool(threads) : NULL;
+  unsigned workers = pool ? nonogram_poolsize(pool) : 1;
+
+  struct search s;
+  s.master = c;
+  s.more = more;
+  s.data = data;
+  s.busy = 0;
+  s.queued = 0;
+  s.done = s.stop = s.failed = false;
+  s.workers = 0;
+  s.worker = malloc(workers * sizeof *s.worker);
+  if (!s.worker) {
+    nonogram_freepool(pool);
+    return nonogram_ERROR;
+  }
+#if nonogram_THREADS
+  pthread_mutex_init(&s.lock, NULL);
+  pthread_cond_init(&s.ready, NULL);
+#endif
+
+  int rc = nonogram_ERROR;
+  while (s.workers < workers)
+    if (initworker(&s.worker[s.workers++], &s) < 0)
+      goto cleanup;
+  if (seed(&s) < 0)
+    goto cleanup;
+
+  if (pool)
+    nonogram_runpool(pool, workers, &explore, &s);
+  else
+    explore(&s, 0, 0);
+  rc = s.failed ? nonogram_ERROR : s.stop ? nonogram_FOUND : nonogram_FINISHED;
+
+ cleanup:
+  for (unsigned i = 0; i < s.workers; i++)
+    termworker(&s.worker[i]);
+  free(s.worker);
+#if nonogram_THREADS
+  pthread_cond_destroy(&s.ready);
+  pthread_mutex_destroy(&s.lock);
+#endif
+  nonogram_freepool(pool);
+  return rc;
+}
@@ -38,8 +38,15 @@
 static void makescore(nonogram_lineattr *attr,
                       const struct nonogram_rule *rule, int len);
 
+static void lineargs(nonogram_solver *, int on_row, size_t lineno,
+                     struct nonogram_initargs *);
+static int initline(const nonogram_solver *,
+                    const struct nonogram_lsnt *, struct nonogram_ws *,
+                    int on_row, size_t lineno,
+                    const struct nonogram_initargs *);
 static void setupstep(nonogram_solver *);
 static void step(nonogram_solver *);
+static void freeparallel(struct nonogram_parallel *);
 
 /* Returns true if a change was detected. */
 static int redeemstep(nonogram_solver *c);
@@ -56,10 +63,47 @@ int nonogram_initsolver(nonogram_solver *c)
 
   /* no display */
   c->display = NULL;
+  c->batchlines = c->batched = 0;
+  c->batcher = NULL;
+
+  /* guess at the first unknown cell */
+  c->guesser = &nonogram_firstguesser;
+  c->guesser_data = NULL;
 
   /* no place to send solutions */
   c->client = NULL;
 
+  /* no memory of pushes */
+  c->pushmemo = false;
+  c->rowmemo = c->colmemo = NULL;
+  c->rowchanged = c->colchanged = NULL;
+  c->mirror = NULL;
+  c->packstack = false;
+
+  /* one line at a time */
+  c->threads = 1;
+  c->parallel = NULL;
+  c->worker = NULL;
+
+  /* no probing */
+  c->probing = 0;
+  c->prober = NULL;
+
+  /* no learning */
+  c->learning = 0;
+  c->learner = NULL;
+
+  /* guessing, not SAT */
+  c->usesat = false;
+  c->sat = NULL;
+
+  /* no line-result cache */
+  c->linecache = NULL;
+  c->uncached = false;
+
+  /* no tracing */
+  c->trace = NULL;
+
   /* no logging */
   c->log.file = NULL;
   c->log.indent = 0;
@@ -70,6 +114,11 @@ int nonogram_initsolver(nonogram_solver *c)
   c->rowattr = c->colattr = NULL;
   c->rowflag = c->colflag = NULL;
   c->stack = NULL;
+  c->usetrail = false;
+  c->trail = NULL;
+  c->traillen = c->trailcap = 0;
+  for (int i = 0; i < nonogram_FRAMECLASSES; i++)
+    c->spare[i] = NULL;
 
   /* start with no linesolvers */
   c->levels = 0;
@@ -79,6 +128,8 @@ int nonogram_initsolver(nonogram_solver *c)
   c->workspace.size = NULL;
   c->workspace.nonogram_size = NULL;
   c->workspace.cell = NULL;
+  c->wsheld.byte = c->wsheld.ptrdiff = c->wsheld.size = 0;
+  c->wsheld.nonogram_size = c->wsheld.cell = 0;
 
   /* then add the default */
   nonogram_setlinesolvers(c, 1);
@@ -102,6 +153,18 @@ int nonogram_termsolver(nonogram_solver *c)
   free(c->workspace.nonogram_size), c->workspace.nonogram_size = NULL;
   free(c->workspace.cell), c->workspace.cell = NULL;
   free(c->work), c->work = NULL;
+  free(c->rowmemo), c->rowmemo = c->colmemo = NULL;
+  free(c->rowchanged), c->rowchanged = c->colchanged = NULL;
+  free(c->mirror), c->mirror = NULL;
+  freeparallel(c->parallel), c->parallel = NULL;
+  nonogram_freeprober(c->prober), c->prober = NULL;
+  nonogram_freelearner(c->learner), c->learner = NULL;
+  nonogram_freebatcher(c->batcher), c->batcher = NULL;
+  nonogram_freeframes(c);
+  free(c->trail), c->trail = NULL;
+  c->trailcap = 0;
+  free(c->linesolver), c->linesolver = NULL;
+  c->levels = 0;
   return 0;
 }
 
@@ -114,24 +177,148 @@ int nonogram_unload(nonogram_solver *c)
     switch (c->status) {
     case nonogram_DONE:
     case nonogram_WORKING:
-      if (c->linesolver[c->level].suite->term)
-        (*c->linesolver[c->level].suite->term)
-          (c->linesolver[c->level].context);
+      if (c->linesolver[c->level - 1].suite->term)
+        (*c->linesolver[c->level - 1].suite->term)
+          (c->linesolver[c->level - 1].context);
       break;
     }
 
   /* free stack */
   while (st) {
     c->stack = st->next;
-    free(st);
+    nonogram_putframe(c, st);
     st = c->stack;
   }
+  nonogram_freesat(c->sat), c->sat = NULL;
   c->focus = false;
   c->puzzle = NULL;
   return 0;
 }
 
-static void gathersolvers(nonogram_solver *c);
+void *nonogram_reserve(void *p, size_t *held, size_t amount)
+{
+  if (p && *held >= amount)
+    return p;
+  free(p);
+  p = malloc(amount ? amount : 1);
+  *held = p ? amount : 0;
+  return p;
+}
+
+static int gathersolvers(nonogram_solver *c, struct nonogram_req *most);
+
+/* Lines of the same orientation awaiting the same line solver don't
+   share cells, so they can be solved at the same time, each worker
+   thread having its own workspace, and then have their results
+   applied one at a time. */
+struct nonogram_parallel {
+  struct nonogram_pool *pool;
+  unsigned threads; /* as requested when the pool was made */
+
+  /* one for each thread, with the workspace it holds */
+  struct worker {
+    struct nonogram_ws ws;
+    struct nonogram_req held;
+    struct nonogram_log log;
+  } *worker;
+
+  /* one for each line in the batch */
+  struct batchline {
+    size_t lineno;
+    int fits;
+    unsigned uncached : 1;
+  } *line;
+  nonogram_cell *result;
+  size_t lineheld, resultheld;
+
+  int on_row;
+  nonogram_level level;
+};
+
+static void freeparallel(struct nonogram_parallel *par)
+{
+  if (!par)
+    return;
+  if (par->worker)
+    for (unsigned i = 0; i < nonogram_poolsize(par->pool); i++) {
+      free(par->worker[i].ws.byte);
+      free(par->worker[i].ws.ptrdiff);
+      free(par->worker[i].ws.size);
+      free(par->worker[i].ws.nonogram_size);
+      free(par->worker[i].ws.cell);
+    }
+  free(par->worker);
+  free(par->line);
+  free(par->result);
+  nonogram_freepool(par->pool);
+  free(par);
+}
+
+/* Prepare 'par' (or a new one, if NULL) for the loaded puzzle.  Its
+   pool and workspace are kept from puzzle to puzzle, unless the
+   number of threads has changed, and grow as puzzles need more.
+   Returns NULL if the solver should work on one line at a time. */
+static struct nonogram_parallel *makeparallel(nonogram_solver *c,
+                                              struct nonogram_parallel *par,
+                                              const struct nonogram_req *req)
+{
+  if (par && par->threads != c->threads)
+    freeparallel(par), par = NULL;
+  if (c->threads < 2)
+    return NULL;
+
+  if (!par) {
+    par = malloc(sizeof *par);
+    if (!par)
+      return NULL;
+    par->threads = c->threads;
+    par->worker = NULL;
+    par->line = NULL;
+    par->result = NULL;
+    par->pool = nonogram_makepool(c->threads);
+    if (!par->pool || nonogram_poolsize(par->pool) < 2) {
+      freeparallel(par);
+      return NULL;
+    }
+    par->worker = calloc(nonogram_poolsize(par->pool), sizeof *par->worker);
+    if (!par->worker) {
+      freeparallel(par);
+      return NULL;
+    }
+  }
+
+  unsigned threads = nonogram_poolsize(par->pool);
+  size_t lines = c->puzzle->width > c->puzzle->height ?
+    c->puzzle->width : c->puzzle->height;
+  par->line = nonogram_reserve(par->line, &par->lineheld,
+                               lines * sizeof *par->line);
+  par->result = nonogram_reserve(par->result, &par->resultheld,
+                                 lines * c->lim.maxline *
+                                 sizeof *par->result);
+  if (!par->line || !par->result) {
+    freeparallel(par);
+    return NULL;
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    struct worker *w = &par->worker[i];
+    w->ws.byte = nonogram_reserve(w->ws.byte, &w->held.byte, req->byte);
+    w->ws.ptrdiff = nonogram_reserve(w->ws.ptrdiff, &w->held.ptrdiff,
+                                     req->ptrdiff * sizeof(ptrdiff_t));
+    w->ws.size = nonogram_reserve(w->ws.size, &w->held.size,
+                                  req->size * sizeof(size_t));
+    w->ws.nonogram_size =
+      nonogram_reserve(w->ws.nonogram_size, &w->held.nonogram_size,
+                       req->nonogram_size * sizeof(nonogram_sizetype));
+    w->ws.cell = nonogram_reserve(w->ws.cell, &w->held.cell,
+                                  req->cell * sizeof(nonogram_cell));
+    if (!w->ws.byte || !w->ws.ptrdiff || !w->ws.size ||
+        !w->ws.nonogram_size || !w->ws.cell) {
+      freeparallel(par);
+      return NULL;
+    }
+  }
+  return par;
+}
 
 int nonogram_load(nonogram_solver *c, const nonogram_puzzle *puzzle,
                   nonogram_cell *grid, int remcells)
@@ -153,8 +340,9 @@ int nonogram_load(nonogram_solver *c, const nonogram_puzzle *puzzle,
   c->grid = grid;
   c->remcells = remcells;
 
-  /* working data */
-  free(c->work);
+  /* Working data is kept from puzzle to puzzle, and replaced only
+     when a puzzle needs more.  On failure, whatever is held is left
+     for the next load or nonogram_termsolver. */
 #if 0
   /* These can't work, since they are allocated in a single block,
      which c->work points to. */
@@ -171,19 +359,107 @@ int nonogram_load(nonogram_solver *c, const nonogram_puzzle *puzzle,
     amount = align(amount, nonogram_lineattr);
     size_t attr_offset = amount;
     amount += sizeof(nonogram_lineattr) * (puzzle->height + puzzle->width);
+    amount = align(amount, size_t);
+    size_t heap_offset = amount;
+    amount += sizeof(size_t) * 2 * (puzzle->height + puzzle->width);
 
-    char *mem = malloc(amount);
-    if (!mem)
-      return -1;
+    char *mem = nonogram_reserve(c->work, &c->workheld, amount);
     c->work = (void *) mem;
+    if (!mem) {
+      c->puzzle = NULL;
+      return -1;
+    }
     c->rowflag = (void *) (mem + flag_offset);
     c->colflag = c->rowflag + puzzle->height;
     c->rowattr = (void *) (mem + attr_offset);
     c->colattr = c->rowattr + puzzle->height;
+    c->heap = (void *) (mem + heap_offset);
+    c->heappos = c->heap + puzzle->height + puzzle->width;
+  }
+
+  /* memory of each line's pushes, allocated in a single block */
+  if (c->pushmemo) {
+    size_t lines = puzzle->height + puzzle->width, rules = 0;
+    for (lineno = 0; lineno < puzzle->height; lineno++)
+      rules += puzzle->row[lineno].len;
+    for (lineno = 0; lineno < puzzle->width; lineno++)
+      rules += puzzle->col[lineno].len;
+
+    size_t amount = sizeof(struct nonogram_pushmemo) * lines;
+    amount = align(amount, ptrdiff_t);
+    size_t solid_offset = amount;
+    amount += sizeof(ptrdiff_t) * 2 * rules;
+    amount = align(amount, nonogram_sizetype);
+    size_t pos_offset = amount;
+    amount += sizeof(nonogram_sizetype) * 2 * rules;
+    size_t line_offset = amount;
+    amount += sizeof(nonogram_cell) * 4 * puzzle->width * puzzle->height;
+
+    char *mem = nonogram_reserve(c->rowmemo, &c->memoheld, amount);
+    c->rowmemo = (void *) mem;
+    if (!mem) {
+      c->colmemo = NULL;
+      c->puzzle = NULL;
+      return -1;
+    }
+    c->colmemo = c->rowmemo + puzzle->height;
+
+    ptrdiff_t *solid = (void *) (mem + solid_offset);
+    nonogram_sizetype *pos = (void *) (mem + pos_offset);
+    nonogram_cell *cells = (void *) (mem + line_offset);
+    for (size_t i = 0; i < lines; i++) {
+      struct nonogram_pushmemo *m = c->rowmemo + i;
+      size_t len, rlen;
+      if (i < puzzle->height)
+        len = puzzle->width, rlen = puzzle->row[i].len;
+      else
+        len = puzzle->height, rlen = puzzle->col[i - puzzle->height].len;
+      for (int dir = 0; dir < 2; dir++) {
+        m->valid[dir] = false;
+        m->line[dir] = cells, cells += len;
+        m->pos[dir] = pos, pos += rlen;
+        m->solid[dir] = solid, solid += rlen;
+      }
+    }
+  } else {
+    free(c->rowmemo), c->rowmemo = c->colmemo = NULL;
+  }
+
+  /* Columns are solved from a copy of the grid with each column
+     contiguous, which is kept up to date with the grid itself. */
+  c->mirror = nonogram_reserve(c->mirror, &c->mirrorheld,
+                               sizeof(nonogram_cell) *
+                               puzzle->width * puzzle->height);
+  if (!c->mirror) {
+    c->puzzle = NULL;
+    return -1;
+  }
+  for (size_t y = 0; y < puzzle->height; y++)
+    for (size_t x = 0; x < puzzle->width; x++)
+      c->mirror[y + x * puzzle->height] = grid[x + y * puzzle->width];
+
+  /* Every cell is new to every line. */
+  c->rowwords =
+    (puzzle->width + nonogram_CHANGEBITS - 1) / nonogram_CHANGEBITS;
+  c->colwords =
+    (puzzle->height + nonogram_CHANGEBITS - 1) / nonogram_CHANGEBITS;
+  c->rowchanged = nonogram_reserve(c->rowchanged, &c->changedheld,
+                                   sizeof *c->rowchanged *
+                                   (c->rowwords * puzzle->height +
+                                    c->colwords * puzzle->width));
+  if (!c->rowchanged) {
+    c->colchanged = NULL;
+    c->puzzle = NULL;
+    return -1;
   }
+  c->colchanged = c->rowchanged + c->rowwords * puzzle->height;
+  memset(c->rowchanged, 0, sizeof *c->rowchanged *
+         (c->rowwords * puzzle->height + c->colwords * puzzle->width));
+  nonogram_touchall(c);
 
   c->reminfo = 0;
   c->stack = NULL;
+  c->traillen = 0;
 
   c->unkarea.min.x = 0;
   c->unkarea.min.y = 0;
@@ -213,8 +489,43 @@ int nonogram_load(nonogram_solver *c, const nonogram_puzzle *puzzle,
 
     makescore(c->rowattr + lineno, rule, puzzle->width);
   }
+  nonogram_rebuildsched(c);
+
+  {
+    struct nonogram_req most;
+    if (gathersolvers(c, &most) < 0) {
+      c->puzzle = NULL;
+      return -1;
+    }
+    c->parallel = makeparallel(c, c->parallel, &most);
+  }
 
-  gathersolvers(c);
+  /* Each of these is kept for the next puzzle, if still wanted. */
+
+  /* Without a prober, we just guess sooner. */
+  if (c->probing) {
+    c->prober = nonogram_makeprober(c->prober, c);
+  } else {
+    nonogram_freeprober(c->prober);
+    c->prober = NULL;
+  }
+
+  /* Without a learner, we just go back to the last guess. */
+  if (c->learning) {
+    c->learner = nonogram_makelearner(c->learner, c);
+  } else {
+    nonogram_freelearner(c->learner);
+    c->learner = NULL;
+  }
+
+  /* Without a batcher, the display is told of each change. */
+  if (c->batchlines && c->display && c->display->flush) {
+    c->batcher = nonogram_makebatcher(c->batcher, c);
+  } else {
+    nonogram_freebatcher(c->batcher);
+    c->batcher = NULL;
+  }
+  c->batched = 0;
 
   /* configure line solver */
   c->status = nonogram_EMPTY;
@@ -226,6 +537,8 @@ static void colfocus(nonogram_solver *c, int lineno, int v);
 static void rowfocus(nonogram_solver *c, int lineno, int v);
 static void mark1col(nonogram_solver *c, int lineno);
 static void mark1row(nonogram_solver *c, int lineno);
+static void showarea(nonogram_solver *c, const struct nonogram_rect *r);
+static void showmarks(nonogram_solver *c, int rows, size_t from, size_t to);
 
 
 static void makeguess(nonogram_solver *c,
@@ -235,13 +548,14 @@ static void makeguess(nonogram_solver *c,
 static void flipguess(nonogram_solver *restrict c,
                       const struct nonogram_point *restrict pos,
                       nonogram_cell old);
-static void chooseguess(nonogram_solver *restrict c,
-                        const struct nonogram_rect *restrict from,
-                        struct nonogram_point *restrict pos,
-                        nonogram_cell *restrict choice);
 static void findminrect(nonogram_solver *c, struct nonogram_rect *b,
                         const struct nonogram_rect *from);
 static void findeasiest(nonogram_solver *c);
+static int probe(nonogram_solver *c);
+static int runsat(nonogram_solver *c, int (*test)(void *), void *data);
+static void fixcell(nonogram_solver *restrict c,
+                    const struct nonogram_point *restrict pos,
+                    nonogram_cell v);
 
 int nonogram_testtries(void *vt)
 {
@@ -274,6 +588,12 @@ int nonogram_runlines_until(nonogram_solver *c, int *lines, clock_t lim)
   return nonogram_runlines(c, lines, &nonogram_testtime, &lim);
 }
 
+int nonogram_runlines_deadline(nonogram_solver *c, int *lines,
+                               struct nonogram_deadline *d)
+{
+  return nonogram_runlines(c, lines, &nonogram_testdeadline, d);
+}
+
 int nonogram_runlines(nonogram_solver *c, int *lines,
                       int (*test)(void *), void *data)
 {
@@ -298,127 +618,371 @@ int nonogram_runcycles_until(nonogram_solver *c, clock_t lim)
   return nonogram_runcycles(c, &nonogram_testtime, &lim);
 }
 
-int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
+int nonogram_runcycles_deadline(nonogram_solver *c,
+                                struct nonogram_deadline *d)
 {
-  if (!c->puzzle) {
+  return nonogram_runcycles(c, &nonogram_testdeadline, d);
+}
+
+struct limits {
+  unsigned long *steps;
+  struct nonogram_deadline *deadline;
+  int expired;
+};
+
+static int withinlimits(struct limits *lim)
+{
+  if (lim->steps) {
+    if (*lim->steps == 0)
+      return !(lim->expired = true);
+    --*lim->steps;
+  }
+  if (lim->deadline && !nonogram_testdeadline(lim->deadline))
+    return !(lim->expired = true);
+  return true;
+}
+
+static int testlimits(void *vl)
+{
+  return withinlimits(vl);
+}
+
+int nonogram_solve(nonogram_solver *c, unsigned long *steps,
+                   struct nonogram_deadline *deadline)
+{
+  struct limits lim = { steps, deadline, false };
+
+  if (!c->puzzle)
     return nonogram_UNLOADED;
-  } else if (c->status == nonogram_WORKING) {
-    /* in the middle of solving a line */
-    while ((*test)(data) && c->status == nonogram_WORKING)
-      step(c);
-    return nonogram_UNFINISHED;
-  } else if (c->status == nonogram_DONE)  {
-    /* a line is solved, but not acted upon */
-    size_t linelen;
 
-    /* indicate end of line-processing */
-    if (c->on_row)
-      rowfocus(c, c->lineno, false), linelen = c->puzzle->width;
-    else
-      colfocus(c, c->lineno, false), linelen = c->puzzle->height;
+  for (;;) {
+    /* Step through the line without going back to the caller. */
+    while (c->status == nonogram_WORKING)
+      if (withinlimits(&lim))
+        step(c);
+      else
+        return nonogram_UNFINISHED;
+
+    /* Everything else happens between steps, and only a SAT search
+       needs to be told when to stop. */
+    int r = nonogram_runcycles(c, &testlimits, &lim);
+    switch (r) {
+    case nonogram_LINE:
+      break;
+    case nonogram_UNFINISHED:
+      if (lim.expired)
+        return r;
+      break;
+    default:
+      return r;
+    }
+  }
+}
+
+/* Act on the result of solving a line, and leave no line chosen. */
+static void finishline(nonogram_solver *c)
+{
+  size_t linelen;
+
+  /* remember the result for next time */
+  if (c->uncached) {
+    struct nonogram_initargs a;
+
+    lineargs(c, c->on_row, c->lineno, &a);
+    nonogram_putcachedline(c->linecache,
+                           c->linesolver[c->level - 1].suite,
+                           c->linesolver[c->level - 1].context, &a);
+    c->uncached = false;
+  }
+
+  /* The line has now seen all its cells as they are. */
+  nonogram_untouchline(c, c->on_row, c->lineno);
+
+  /* indicate end of line-processing */
+  if (c->on_row)
+    rowfocus(c, c->lineno, false), linelen = c->puzzle->width;
+  else
+    colfocus(c, c->lineno, false), linelen = c->puzzle->height;
 
 #if false
-    if (c->logfile) {
-      fprintf(c->logfile, "%*sFits: %d\n", c->indent, "", c->fits);
-      fflush(c->logfile);
+  if (c->logfile) {
+    fprintf(c->logfile, "%*sFits: %d\n", c->indent, "", c->fits);
+    fflush(c->logfile);
+  }
+#endif
+
+  /* Any cells set follow from the line's known cells. */
+  if (c->learner)
+    nonogram_whyline(c);
+
+  /* test for consistency */
+  if (c->fits == 0) {
+    /* nothing fitted; must be an error */
+    c->remcells = -1;
+    if (c->learner)
+      nonogram_blame(c);
+    if (c->trace)
+      nonogram_tracepoint(c->trace, nonogram_EVCONFLICT,
+                          c->on_row ? nonogram_EVROW : 0, c->level,
+                          c->lineno, 0, 0);
+#if nonogram_LOGLEVEL > 0
+    if (c->log.file) {
+      fprintf(c->log.file, "%*s         Inconsistency!\n",
+              c->log.indent, "");
+      fflush(c->log.file);
     }
 #endif
+  } else {
+    int changed;
 
-    /* test for consistency */
-    if (c->fits == 0) {
-      /* nothing fitted; must be an error */
-      c->remcells = -1;
 #if nonogram_LOGLEVEL > 0
-      if (c->log.file) {
-        fprintf(c->log.file, "%*s         Inconsistency!\n",
-                c->log.indent, "");
-        fflush(c->log.file);
-      }
+    if (c->log.file) {
+      size_t i;
+      fprintf(c->log.file, "%*s   End: >", c->log.indent, "");
+      for (i = 0; i < linelen; i++)
+        switch (c->work[i]) {
+        case nonogram_BLANK:
+          fputc(' ', c->log.file);
+          break;
+        case nonogram_DOT:
+          fputc('-', c->log.file);
+          break;
+        case nonogram_SOLID:
+          fputc('#', c->log.file);
+          break;
+        case nonogram_BOTH:
+          fputc('+', c->log.file);
+          break;
+        default:
+          fputc('?', c->log.file);
+          break;
+        }
+      fprintf(c->log.file, "<\n");
+      fflush(c->log.file);
+    } /* log file reported */
 #endif
+
+    /* update display and count number of changed cells and flags */
+    changed = redeemstep(c);
+    if (c->trace)
+      nonogram_tracepoint(c->trace, nonogram_EVEND,
+                          c->on_row ? nonogram_EVROW : 0, c->level,
+                          c->lineno, changed, c->remcells);
+
+    /* indicate choice to display */
+    if (c->on_row) {
+      if (c->rowattr[c->lineno].dot == 0 &&
+          c->rowattr[c->lineno].solid == 0)
+        c->rowflag[c->lineno] = 0;
+      else if (c->fits < 0 && changed)
+        c->rowflag[c->lineno] = c->levels;
+      else
+        --c->rowflag[c->lineno];
+      if (!c->rowflag[c->lineno]) c->reminfo--;
+      nonogram_resched(c, c->lineno);
+      mark1row(c, c->lineno);
     } else {
-      int changed;
+      if (c->colattr[c->lineno].dot == 0 &&
+          c->colattr[c->lineno].solid == 0)
+        c->colflag[c->lineno] = 0;
+      else if (c->fits < 0 && changed)
+        c->colflag[c->lineno] = c->levels;
+      else
+        --c->colflag[c->lineno];
+      if (!c->colflag[c->lineno]) c->reminfo--;
+      nonogram_resched(c, c->puzzle->height + c->lineno);
+      mark1col(c, c->lineno);
+    }
+  }
 
 #if nonogram_LOGLEVEL > 0
-      if (c->log.file) {
-        size_t i;
-        fprintf(c->log.file, "%*s   End: >", c->log.indent, "");
-        for (i = 0; i < linelen; i++)
-          switch (c->work[i]) {
-          case nonogram_BLANK:
-            fputc(' ', c->log.file);
-            break;
-          case nonogram_DOT:
-            fputc('-', c->log.file);
-            break;
-          case nonogram_SOLID:
-            fputc('#', c->log.file);
-            break;
-          case nonogram_BOTH:
-            fputc('+', c->log.file);
-            break;
-          default:
-            fputc('?', c->log.file);
-            break;
-          }
-        fprintf(c->log.file, "<\n");
-        fflush(c->log.file);
-      } /* log file reported */
+  c->log.indent -= 2;
+  if (c->log.file) {
+    fprintf(c->log.file, "%*s}%s\n", c->log.indent, "",
+            c->reversed ? " reversed" : "");
+    fflush(c->log.file);
+  }
 #endif
 
-      /* update display and count number of changed cells and flags */
-      changed = redeemstep(c);
+#if nonogram_LOGLEVEL > 0
+  if (c->log.file) {
+    fprintf(c->log.file, "%*sCells: %d; Lines: %d\n", c->log.indent, "",
+            c->remcells, c->reminfo);
+    fflush(c->log.file);
+  }
+#endif
 
-      /* indicate choice to display */
-      if (c->on_row) {
-        if (c->rowattr[c->lineno].dot == 0 &&
-            c->rowattr[c->lineno].solid == 0)
-          c->rowflag[c->lineno] = 0;
-        else if (c->fits < 0 && changed)
-          c->rowflag[c->lineno] = c->levels;
-        else
-          --c->rowflag[c->lineno];
-        if (!c->rowflag[c->lineno]) c->reminfo--;
-        mark1row(c, c->lineno);
-      } else {
-        if (c->colattr[c->lineno].dot == 0 &&
-            c->colattr[c->lineno].solid == 0)
-          c->colflag[c->lineno] = 0;
-        else if (c->fits < 0 && changed)
-          c->colflag[c->lineno] = c->levels;
-        else
-          --c->colflag[c->lineno];
-        if (!c->colflag[c->lineno]) c->reminfo--;
-        mark1col(c, c->lineno);
-      }
-    }
+  /* set state to indicate no line currently chosen */
+  c->status = nonogram_EMPTY;
+
+  /* Show the changes of the last few lines together. */
+  if (c->batcher && ++c->batched >= c->batchlines)
+    nonogram_flushdisplay(c);
+}
+
+static void solvebatched(void *vc, size_t i, unsigned wno)
+{
+  nonogram_solver *c = vc;
+  struct nonogram_parallel *par = c->parallel;
+  struct batchline *bl = &par->line[i];
+  struct worker *w = &par->worker[wno];
+  const struct nonogram_lsnt *ls = &c->linesolver[par->level - 1];
+  struct nonogram_initargs a;
+
+  lineargs(c, par->on_row, bl->lineno, &a);
+  a.fits = &bl->fits;
+  w->log.file = NULL;
+  w->log.indent = w->log.level = 0;
+  a.log = &w->log;
+  a.result = par->result + i * c->lim.maxline;
+
+  /* The result is stored when it is applied. */
+  bl->uncached = false;
+  if (c->linecache) {
+    if (nonogram_getcachedline(c->linecache, ls->suite, ls->context, &a))
+      return;
+    bl->uncached = true;
+  }
+
+  if (initline(c, ls, &w->ws, par->on_row, bl->lineno, &a) &&
+      ls->suite->step)
+    while ((*ls->suite->step)(ls->context, w->ws.byte))
+      ;
+}
+
+/* Record the start of work on the current line. */
+static void traceline(nonogram_solver *c)
+{
+  nonogram_tracepoint(c->trace, nonogram_EVLINE,
+                      c->on_row ? nonogram_EVROW : 0, c->level, c->lineno,
+                      c->on_row ? c->rowattr[c->lineno].score :
+                      c->colattr[c->lineno].score, 0);
+}
 
+/* Set up context for solving the chosen row or column, to be
+   closed by finishline. */
+static void openline(nonogram_solver *c)
+{
+  if (c->on_row) {
+#if nonogram_LOGLEVEL > 0
+    if (c->log.file) {
+      fprintf(c->log.file, "%*sRow %d [%d]: (%lu) ",
+              c->log.indent, "", c->lineno, c->rowattr[c->lineno].score,
+              (unsigned long) c->puzzle->row[c->lineno].len);
+      nonogram_printrule(c->puzzle->row + c->lineno, c->log.file);
+      fprintf(c->log.file, " {\n");
+      fflush(c->log.file);
+    }
+#endif
+    c->log.indent += 2;
+    c->editarea.max.y = (c->editarea.min.y = c->lineno) + 1;
+    rowfocus(c, c->lineno, true);
+  } else {
 #if nonogram_LOGLEVEL > 0
-    c->log.indent -= 2;
     if (c->log.file) {
-      fprintf(c->log.file, "%*s}%s\n", c->log.indent, "",
-              c->reversed ? " reversed" : "");
+      fprintf(c->log.file, "%*sColumn %d [%d]: (%lu) ",
+              c->log.indent, "", c->lineno, c->colattr[c->lineno].score,
+              (unsigned long) c->puzzle->col[c->lineno].len);
+      nonogram_printrule(c->puzzle->col + c->lineno, c->log.file);
+      fprintf(c->log.file, " {\n");
       fflush(c->log.file);
     }
 #endif
+    c->log.indent += 2;
+    c->editarea.max.x = (c->editarea.min.x = c->lineno) + 1;
+    colfocus(c, c->lineno, true);
+  }
+}
 
+/* At most this many lines per thread are solved in one batch, so
+   that the caller's test is still checked between batches. */
+#define BATCHPERTHREAD 4
+
+/* Solve lines like the one chosen by findeasiest together, starting
+   with that one.  Return false if there are too few to bother. */
+static int runbatch(nonogram_solver *c)
+{
+  struct nonogram_parallel *par = c->parallel;
+  const struct nonogram_lsnt *ls;
+  const nonogram_level *flag;
+  size_t lines, linelen, most, n, i, k;
+
+  if (c->level < 1 || c->level > c->levels)
+    return false;
+  ls = &c->linesolver[c->level - 1];
+  if (!ls->suite || !ls->suite->init)
+    return false;
+
+  if (c->on_row) {
+    lines = c->puzzle->height;
+    linelen = c->puzzle->width;
+    flag = c->rowflag;
+  } else {
+    lines = c->puzzle->width;
+    linelen = c->puzzle->height;
+    flag = c->colflag;
+  }
+  most = (size_t) nonogram_poolsize(par->pool) * BATCHPERTHREAD;
+  for (n = k = 0; k < lines && n < most; k++) {
+    i = (c->lineno + k) % lines;
+    if (flag[i] == c->level)
+      par->line[n++].lineno = i;
+  }
+  if (n < 2)
+    return false;
+  par->on_row = c->on_row;
+  par->level = c->level;
+
+  nonogram_runpool(par->pool, n, &solvebatched, c);
+
+  /* Apply the results as if the lines had been solved in turn. */
+  for (i = 0; i < n && c->remcells >= 0; i++) {
+    c->lineno = par->line[i].lineno;
+    openline(c);
+    if (c->trace)
+      traceline(c);
 #if nonogram_LOGLEVEL > 0
     if (c->log.file) {
-      fprintf(c->log.file, "%*sCells: %d; Lines: %d\n", c->log.indent, "",
-              c->remcells, c->reminfo);
+      fprintf(c->log.file, "%*s Batched\n", c->log.indent, "");
       fflush(c->log.file);
     }
 #endif
+    memcpy(c->work, par->result + i * c->lim.maxline,
+           linelen * sizeof(nonogram_cell));
+    c->fits = par->line[i].fits;
+    c->uncached = par->line[i].uncached;
+    c->reversed = false;
+    finishline(c);
+  }
+  return true;
+}
 
-    /* set state to indicate no line currently chosen */
-    c->status = nonogram_EMPTY;
+int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
+{
+  if (!c->puzzle) {
+    return nonogram_UNLOADED;
+  } else if (c->status == nonogram_WORKING) {
+    /* in the middle of solving a line */
+    while ((*test)(data) && c->status == nonogram_WORKING)
+      step(c);
+    return nonogram_UNFINISHED;
+  } else if (c->status == nonogram_DONE)  {
+    /* a line is solved, but not acted upon */
+    finishline(c);
     return nonogram_LINE;
   } else if (c->remcells < 0) {
     /* back-track caused by error or completion of grid */
     nonogram_stack *st = c->stack;
 
+    /* Skip guesses that had nothing to do with it. */
+    if (c->learner)
+      st = nonogram_backjump(c);
+
     /* If there is nothing pushed, there's an error in the puzzle (I
        think). */
     if (!st) {
+      if (c->batcher)
+        nonogram_flushdisplay(c);
       return nonogram_FINISHED;
     } else {
       assert(st);
@@ -458,55 +1022,78 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
 
       c->reversed = false;
 
-      /* Restore rows. */
-      for (size_t y = 0; y < h; y++) {
-        /* Translate the co-ordinate system. */
-        const size_t ry = y + st->unkarea.min.y;
-
-        /* Restore each row of cells. */
-        memcpy(c->grid + st->unkarea.min.x + ry * c->puzzle->width,
-               st->grid + y * w, w * sizeof(nonogram_cell));
-
-        /* Indicate that the line has no solvers yet to be applied. */
-        c->rowflag[ry] = 0;
+      if (c->usetrail) {
+        /* Undo the cells set since the guess. */
+        nonogram_undotrail(c, st->trailmark);
 
-        /* Also restore scores. */
-        c->rowattr[ry] = st->rowattr[y];
-      }
+        /* Indicate that the lines have no solvers yet to be applied. */
+        for (size_t y = 0; y < h; y++)
+          c->rowflag[y + st->unkarea.min.y] = 0;
+        for (size_t x = 0; x < w; x++)
+          c->colflag[x + st->unkarea.min.x] = 0;
+      } else {
+        /* Restore rows. */
+        nonogram_toucharea(c, &st->unkarea);
+        for (size_t y = 0; y < h; y++) {
+          /* Translate the co-ordinate system. */
+          const size_t ry = y + st->unkarea.min.y;
+
+          /* Restore each row of cells. */
+          nonogram_cell *row =
+            c->grid + st->unkarea.min.x + ry * c->puzzle->width;
+          if (c->packstack)
+            nonogram_unpackcells(row,
+                                 st->grid + y * nonogram_packedsize(w), w);
+          else
+            memcpy(row, st->grid + y * w, w * sizeof(nonogram_cell));
+          for (size_t x = 0; x < w; x++)
+            c->mirror[ry + (x + st->unkarea.min.x) * c->puzzle->height] =
+              row[x];
+
+          /* Indicate that the line has no solvers yet to be applied. */
+          c->rowflag[ry] = 0;
+
+          /* Also restore scores. */
+          c->rowattr[ry] = st->rowattr[y];
+        }
 
-      /* Restore columns. */
-      for (size_t x = 0; x < w; x++) {
-        /* Translate the co-ordinate system. */
-        const size_t rx = x + st->unkarea.min.x;
+        /* Restore columns. */
+        for (size_t x = 0; x < w; x++) {
+          /* Translate the co-ordinate system. */
+          const size_t rx = x + st->unkarea.min.x;
 
-        /* Indicate that the line has no solvers yet to be applied. */
-        c->colflag[rx] = 0;
+          /* Indicate that the line has no solvers yet to be applied. */
+          c->colflag[rx] = 0;
 
-        /* Also restore scores. */
-        c->colattr[rx] = st->colattr[x];
+          /* Also restore scores. */
+          c->colattr[rx] = st->colattr[x];
+        }
       }
 
       /* Correct the flags for the row and column where the last guess
          was made. */
       c->colflag[st->guesspos.x] = c->levels;
       c->rowflag[st->guesspos.y] = c->levels;
+      nonogram_rebuildsched(c);
+
+      /* The guess is no longer a guess. */
+      if (c->learner)
+        nonogram_because(c, st->guesspos.x, st->guesspos.y);
 
       /* Update screen with restored data. */
-      if (c->display && c->display->redrawarea)
-        (*c->display->redrawarea)(c->display_data, &st->unkarea);
-      if (c->display && c->display->colmark)
-        (*c->display->colmark)(c->display_data,
-                               st->unkarea.min.x, st->unkarea.max.x);
-      if (c->display && c->display->rowmark)
-        (*c->display->rowmark)(c->display_data,
-                               st->unkarea.min.y, st->unkarea.max.y);
+      showarea(c, &st->unkarea);
+      showmarks(c, false, st->unkarea.min.x, st->unkarea.max.x);
+      showmarks(c, true, st->unkarea.min.y, st->unkarea.max.y);
 
       /* Pop the entry from the stack. */
+      if (c->trace)
+        nonogram_tracepoint(c->trace, nonogram_EVPOP, 0, st->depth,
+                            st->guesspos.x, st->guesspos.y, c->remcells);
       c->log.indent -= 2;
       if (c->log.file)
         fprintf(c->log.file, "%*s}\n", c->log.indent, "");
       c->stack = st->next;
-      free(st);
+      nonogram_putframe(c, st);
       return nonogram_LINE;
       /* back-tracking dealt with */
     }
@@ -514,36 +1101,12 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
     /* no errors, but there are still lines to test */
     findeasiest(c);
 
+    /* solve all similar lines at once, if we can */
+    if (c->parallel && runbatch(c))
+      return nonogram_LINE;
+
     /* set up context for solving a row or column */
-    if (c->on_row) {
-#if nonogram_LOGLEVEL > 0
-      if (c->log.file) {
-        fprintf(c->log.file, "%*sRow %d [%d]: (%lu) ",
-                c->log.indent, "", c->lineno, c->rowattr[c->lineno].score,
-                (unsigned long) c->puzzle->row[c->lineno].len);
-        nonogram_printrule(c->puzzle->row + c->lineno, c->log.file);
-        fprintf(c->log.file, " {\n");
-        fflush(c->log.file);
-      }
-#endif
-      c->log.indent += 2;
-      c->editarea.max.y = (c->editarea.min.y = c->lineno) + 1;
-      rowfocus(c, c->lineno, true);
-    } else {
-#if nonogram_LOGLEVEL > 0
-      if (c->log.file) {
-        fprintf(c->log.file, "%*sColumn %d [%d]: (%lu) ",
-                c->log.indent, "", c->lineno, c->colattr[c->lineno].score,
-                (unsigned long) c->puzzle->col[c->lineno].len);
-        nonogram_printrule(c->puzzle->col + c->lineno, c->log.file);
-        fprintf(c->log.file, " {\n");
-        fflush(c->log.file);
-      }
-#endif
-      c->log.indent += 2;
-      c->editarea.max.x = (c->editarea.min.x = c->lineno) + 1;
-      colfocus(c, c->lineno, true);
-    }
+    openline(c);
     setupstep(c);
     /* a line still to be tested has now been set up for solution */
     return nonogram_UNFINISHED;
@@ -556,6 +1119,11 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
       fflush(c->log.file);
     }
 #endif
+    if (c->trace)
+      nonogram_tracepoint(c->trace, nonogram_EVFOUND, 0,
+                          c->stack ? c->stack->depth : 0, 0, 0, 0);
+    if (c->batcher)
+      nonogram_flushdisplay(c);
     if (c->client && c->client->present)
       (*c->client->present)(c->client_data);
     c->remcells = -1;
@@ -564,6 +1132,37 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
     /* There is no more info to process, no errors, yet some cells
        left. */
 
+    /* Once SAT has taken over, it finds the rest. */
+    if (c->sat)
+      return runsat(c, test, data);
+
+    /* See if what was learned from earlier inconsistencies applies. */
+    if (c->learner) {
+      struct nonogram_point pos;
+      nonogram_cell v;
+      switch (nonogram_checknogoods(c, &pos, &v)) {
+      case -1:
+        c->remcells = -1;
+        return nonogram_LINE;
+      case 1:
+        fixcell(c, &pos, v);
+        return nonogram_LINE;
+      }
+    }
+
+    /* See if any cells can be deduced by trying them both ways. */
+    if (c->prober && probe(c))
+      return nonogram_LINE;
+
+    /* Search the rest with SAT rather than by guessing.  Parallel
+       searches still guess, to share out the work. */
+    if (c->usesat && !c->worker) {
+      c->sat = nonogram_makesat(c);
+      if (!c->sat)
+        return nonogram_ERROR;
+      return runsat(c, test, data);
+    }
+
     /* Make a complementary pair of guesses.  Push one onto the stack
        and leave the other one in our main working area.  When we
        later exhaust the current one, we'll simply discard it and
@@ -582,24 +1181,49 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
     /* Choose a position to make guess. */
     struct nonogram_point pos;
     nonogram_cell choice;
-    chooseguess(c, &area, &pos, &choice);
+    (*c->guesser->choose)(c->guesser_data, c, &area, &pos, &choice);
+
+    /* Make sure the trail can record every cell that could be set
+       before the next guess. */
+    if (c->usetrail && !c->worker && nonogram_reservetrail(c) < 0)
+      return nonogram_ERROR;
+    if (c->learner && nonogram_reservelearner(c) < 0)
+      return nonogram_ERROR;
 
     /* Make one guess before saving on the stack, and work out what
        the alternative is. */
     nonogram_cell alt_choice;
     makeguess(c, &pos, choice, &alt_choice);
 
+    /* In a parallel search, this guess becomes a task which any
+       worker may pick up, so nothing is pushed. */
+    if (c->worker) {
+      if (nonogram_spawn(c->worker, c, &pos) < 0)
+        return nonogram_ERROR;
+      flipguess(c, &pos, alt_choice);
+      return nonogram_LINE;
+    }
+
     /* Allocate space for a new stack element, a copy of the affected
        grid, and associated line attributes. */
     nonogram_stack *st;
-    {
+    if (c->usetrail) {
+      /* Only the trail's length need be saved. */
+      st = nonogram_getframe(c, sizeof(nonogram_stack));
+      if (!st)
+        return nonogram_ERROR;
+      st->grid = NULL;
+      st->rowattr = st->colattr = NULL;
+      st->trailmark = c->traillen;
+    } else {
       size_t amount = sizeof(nonogram_stack);
       size_t grid_offset = amount = align(amount, nonogram_cell);
-      amount += w * h * sizeof(nonogram_cell);
+      amount += c->packstack ?
+        h * nonogram_packedsize(w) : w * h * sizeof(nonogram_cell);
       size_t attr_offset = amount = align(amount, nonogram_lineattr);
       amount += (w + h) * sizeof(nonogram_lineattr);
 
-      char *mem = malloc(amount);
+      char *mem = (void *) nonogram_getframe(c, amount);
       if (!mem)
         return nonogram_ERROR;
       st = (void *) mem;
@@ -608,6 +1232,7 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
       st->colattr = st->rowattr + h;
     }
     st->next = c->stack;
+    st->depth = st->next ? st->next->depth + 1 : 1;
     c->stack = st;
 
     /* Record the current state. */
@@ -616,21 +1241,26 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
     st->remcells = c->remcells;
 
     /* Copy rows. */
-    for (size_t y = 0; y < h; y++) {
+    for (size_t y = 0; y < h && !c->usetrail; y++) {
       /* Translate the co-ordinate system. */
       const size_t ry = y + st->unkarea.min.y;
 
       /* Copy a row of cells. */
-      memcpy(st->grid + y * w,
-             c->grid + st->unkarea.min.x + ry * c->puzzle->width,
-             w * sizeof(nonogram_cell));
+      if (c->packstack)
+        nonogram_packcells(st->grid + y * nonogram_packedsize(w),
+                           c->grid + st->unkarea.min.x + ry * c->puzzle->width,
+                           w);
+      else
+        memcpy(st->grid + y * w,
+               c->grid + st->unkarea.min.x + ry * c->puzzle->width,
+               w * sizeof(nonogram_cell));
 
       /* Copy row attributes. */
       st->rowattr[y] = c->rowattr[ry];
     }
 
     /* Copy columns. */
-    for (size_t x = 0; x < w; x++) {
+    for (size_t x = 0; x < w && !c->usetrail; x++) {
       const size_t rx = x + st->unkarea.min.x;
       st->colattr[x] = c->colattr[rx];
     }
@@ -647,10 +1277,15 @@ int nonogram_runcycles(nonogram_solver *c, int (*test)(void *), void *data)
     }
 #endif
     c->log.indent += 2;
+    if (c->trace)
+      nonogram_tracepoint(c->trace, nonogram_EVPUSH, choice, st->depth,
+                          pos.x, pos.y, c->remcells);
 
     /* Flip the guess in the current state, adjusting the heuristics
        for the corresponding row and column. */
     flipguess(c, &pos, alt_choice);
+    if (c->learner)
+      nonogram_guessed(c, pos.x, pos.y);
 
     return nonogram_LINE;
   }
@@ -663,7 +1298,10 @@ static void flipguess(nonogram_solver *restrict c,
                       nonogram_cell newval)
 {
   /* Change the cell to the alternative guess. */
+  nonogram_trailcell(c, pos->x, pos->y);
   c->grid[pos->x + pos->y * c->puzzle->width] = newval;
+  c->mirror[pos->y + pos->x * c->puzzle->height] = newval;
+  nonogram_touchcell(c, pos->x, pos->y);
 #if nonogram_LOGLEVEL > 0
   if (c->log.file) {
     fprintf(c->log.file, "%*sFlipped guess %c at (%zu,%zu)\n",
@@ -673,6 +1311,9 @@ static void flipguess(nonogram_solver *restrict c,
     fflush(c->log.file);
   }
 #endif
+  if (c->trace)
+    nonogram_tracepoint(c->trace, nonogram_EVFLIP, newval,
+                        c->stack ? c->stack->depth : 0, pos->x, pos->y, 0);
 
   if (newval == nonogram_SOLID) {
     /* Update the row heuristics. */
@@ -694,16 +1335,18 @@ static void flipguess(nonogram_solver *restrict c,
 
   /* Make the row and column selectable for processing. */
   c->rowflag[pos->y] = c->levels;
+  nonogram_resched(c, pos->y);
   c->colflag[pos->x] = c->levels;
+  nonogram_resched(c, c->puzzle->height + pos->x);
   mark1row(c, pos->y);
   mark1col(c, pos->x);
 
   /* Update the display. */
-  if (c->display && c->display->redrawarea) {
+  {
     struct nonogram_rect gp;
     gp.max.x = (gp.min.x = pos->x) + 1;
     gp.max.y = (gp.min.y = pos->y) + 1;
-    (*c->display->redrawarea)(c->display_data, &gp);
+    showarea(c, &gp);
   }
 }
 
@@ -718,7 +1361,10 @@ static void makeguess(nonogram_solver *restrict c,
   *altp = guess ^ nonogram_BOTH;
 
   /* Change the grid to reflect the guess. */
+  nonogram_trailcell(c, pos->x, pos->y);
   c->grid[pos->x + pos->y * c->puzzle->width] = guess;
+  c->mirror[pos->y + pos->x * c->puzzle->height] = guess;
+  nonogram_touchcell(c, pos->x, pos->y);
 #if nonogram_LOGLEVEL > 0
   if (c->log.file) {
     fprintf(c->log.file, "%*sGuessing %c at (%zu,%zu)\n", c->log.indent, "",
@@ -727,6 +1373,9 @@ static void makeguess(nonogram_solver *restrict c,
     fflush(c->log.file);
   }
 #endif
+  if (c->trace)
+    nonogram_tracepoint(c->trace, nonogram_EVGUESS, guess,
+                        c->stack ? c->stack->depth : 0, pos->x, pos->y, 0);
 
   /* Update heuristics for row. */
   if (!--*(guess == nonogram_DOT ?
@@ -734,6 +1383,7 @@ static void makeguess(nonogram_solver *restrict c,
     c->rowattr[pos->y].score = c->puzzle->height;
   else
     c->rowattr[pos->y].score++;
+  nonogram_resched(c, pos->y);
 
   /* Update heuristics for column. */
   if (!--*(guess == nonogram_DOT ?
@@ -741,6 +1391,7 @@ static void makeguess(nonogram_solver *restrict c,
     c->colattr[pos->x].score = c->puzzle->width;
   else
     c->colattr[pos->x].score++;
+  nonogram_resched(c, c->puzzle->height + pos->x);
 
   /* Update other summary information for the grid. */
   c->remcells--;
@@ -754,6 +1405,156 @@ static void makeguess(nonogram_solver *restrict c,
 #endif
 }
 
+/* Set a cell deduced by probing or from a nogood, and have its row
+   and column solved again. */
+static void fixcell(nonogram_solver *restrict c,
+                    const struct nonogram_point *restrict pos,
+                    nonogram_cell v)
+{
+  nonogram_lineattr *attr;
+
+  nonogram_trailcell(c, pos->x, pos->y);
+  c->grid[pos->x + pos->y * c->puzzle->width] = v;
+  c->mirror[pos->y + pos->x * c->puzzle->height] = v;
+  nonogram_touchcell(c, pos->x, pos->y);
+  if (c->learner)
+    nonogram_because(c, pos->x, pos->y);
+  c->remcells--;
+#if nonogram_LOGLEVEL > 0
+  if (c->log.file) {
+    fprintf(c->log.file, "%*sProbed %c at (%zu,%zu)\n", c->log.indent, "",
+            v == nonogram_DOT ? '-' : '#', pos->x, pos->y);
+    fflush(c->log.file);
+  }
+#endif
+  if (c->trace)
+    nonogram_tracepoint(c->trace, nonogram_EVFIX, v,
+                        c->stack ? c->stack->depth : 0, pos->x, pos->y, 0);
+
+  attr = &c->rowattr[pos->y];
+  if (!--*(v == nonogram_DOT ? &attr->dot : &attr->solid))
+    attr->score = c->puzzle->width;
+  else
+    attr->score++;
+  if (!c->rowflag[pos->y]) c->reminfo++;
+  c->rowflag[pos->y] = c->levels;
+  nonogram_resched(c, pos->y);
+
+  attr = &c->colattr[pos->x];
+  if (!--*(v == nonogram_DOT ? &attr->dot : &attr->solid))
+    attr->score = c->puzzle->height;
+  else
+    attr->score++;
+  if (!c->colflag[pos->x]) c->reminfo++;
+  c->colflag[pos->x] = c->levels;
+  nonogram_resched(c, c->puzzle->height + pos->x);
+
+  mark1row(c, pos->y);
+  mark1col(c, pos->x);
+  {
+    struct nonogram_rect gp;
+    gp.max.x = (gp.min.x = pos->x) + 1;
+    gp.max.y = (gp.min.y = pos->y) + 1;
+    showarea(c, &gp);
+  }
+}
+
+/* Try each unknown cell both ways.  If one way is inconsistent, the
+   cell must be the other; if both ways agree on other cells, they
+   must be so.  Return true as soon as anything is learned. */
+static int probe(nonogram_solver *c)
+{
+  const size_t width = c->puzzle->width;
+  struct nonogram_point pos;
+
+  /* Whatever is found follows from some of the guesses so far. */
+  if (c->learner)
+    nonogram_whyall(c);
+
+  for (pos.y = c->unkarea.min.y; pos.y < c->unkarea.max.y; pos.y++)
+    for (pos.x = c->unkarea.min.x; pos.x < c->unkarea.max.x; pos.x++) {
+      if (c->grid[pos.x + pos.y * width] != nonogram_BLANK)
+        continue;
+
+      const nonogram_cell *dot =
+        nonogram_probe(c->prober, c, &pos, nonogram_DOT, 0);
+      const nonogram_cell *solid =
+        nonogram_probe(c->prober, c, &pos, nonogram_SOLID, 1);
+
+      if (!dot && !solid) {
+#if nonogram_LOGLEVEL > 0
+        if (c->log.file) {
+          fprintf(c->log.file, "%*sNeither way fits at (%zu,%zu)\n",
+                  c->log.indent, "", pos.x, pos.y);
+          fflush(c->log.file);
+        }
+#endif
+        c->remcells = -1;
+        return true;
+      }
+      if (!dot) {
+        fixcell(c, &pos, nonogram_SOLID);
+        return true;
+      }
+      if (!solid) {
+        fixcell(c, &pos, nonogram_DOT);
+        return true;
+      }
+
+      int fixed = false;
+      struct nonogram_point p;
+      for (p.y = c->unkarea.min.y; p.y < c->unkarea.max.y; p.y++)
+        for (p.x = c->unkarea.min.x; p.x < c->unkarea.max.x; p.x++) {
+          size_t i = p.x + p.y * width;
+          if (c->grid[i] == nonogram_BLANK && dot[i] != nonogram_BLANK &&
+              dot[i] == solid[i]) {
+            fixcell(c, &p, dot[i]);
+            fixed = true;
+          }
+        }
+      if (fixed)
+        return true;
+    }
+  return false;
+}
+
+/* Continue the SAT search, presenting each solution it finds. */
+static int runsat(nonogram_solver *c, int (*test)(void *), void *data)
+{
+  /* Take the last solution off the grid. */
+  if (nonogram_clearsat(c))
+    showarea(c, &c->unkarea);
+
+  switch (nonogram_runsat(c, test, data)) {
+  case nonogram_FOUND:
+    showarea(c, &c->unkarea);
+    if (c->batcher)
+      nonogram_flushdisplay(c);
+#if nonogram_LOGLEVEL > 0
+    if (c->log.file) {
+      fprintf(c->log.file, "%*sCorrect grid.\n", c->log.indent, "");
+      fflush(c->log.file);
+    }
+#endif
+    if (c->trace)
+      nonogram_tracepoint(c->trace, nonogram_EVFOUND, 0,
+                          c->stack ? c->stack->depth : 0, 0, 0, 0);
+    if (c->client && c->client->present)
+      (*c->client->present)(c->client_data);
+    return nonogram_FOUND;
+
+  case nonogram_FINISHED:
+    /* Nothing more, so back-track as if inconsistent. */
+    nonogram_freesat(c->sat), c->sat = NULL;
+    c->remcells = -1;
+    return nonogram_LINE;
+
+  case nonogram_ERROR:
+    return nonogram_ERROR;
+  }
+  return nonogram_UNFINISHED;
+}
+
 /* This sets the rectangle *b to the smallest inclusive rectangle that
  * covers all the unknown cells. */
 static void findminrect(nonogram_solver *restrict c,
@@ -1014,32 +1815,12 @@ static void findminrect(nonogram_solver *restrict c,
 
 static void findeasiest(nonogram_solver *c)
 {
-  int score;
-  size_t i;
-
-  c->level = c->rowflag[0];
-  score = c->rowattr[0].score;
-  c->on_row = true;
-  c->lineno = 0;
-
-  for (i = 0; i < c->puzzle->height; i++)
-    if (c->rowflag[i] > c->level ||
-        (c->level > 0 && c->rowflag[i] == c->level &&
-         c->rowattr[i].score > score)) {
-      c->level = c->rowflag[i];
-      score = c->rowattr[i].score;
-      c->lineno = i;
-    }
+  /* The best line is at the top of the heap. */
+  size_t line = c->heaplen ? c->heap[0] : 0;
 
-  for (i = 0; i < c->puzzle->width; i++)
-    if (c->colflag[i] > c->level ||
-        (c->level > 0 && c->colflag[i] == c->level &&
-         c->colattr[i].score > score)) {
-      c->level = c->colflag[i];
-      score = c->colattr[i].score;
-      c->lineno = i;
-      c->on_row = false;
-    }
+  c->level = c->rowflag[line];
+  c->on_row = line < c->puzzle->height;
+  c->lineno = c->on_row ? line : line - c->puzzle->height;
 }
 
 static void makescore(nonogram_lineattr *attr,
@@ -1075,21 +1856,40 @@ static void rowfocus(nonogram_solver *c, int lineno, int v)
 
 static void mark1col(nonogram_solver *c, int lineno)
 {
-  if (c->display && c->display->colmark)
-    (*c->display->colmark)(c->display_data, lineno, lineno + 1);
+  showmarks(c, false, lineno, lineno + 1);
 }
 
 static void mark1row(nonogram_solver *c, int lineno)
 {
-  if (c->display && c->display->rowmark)
-    (*c->display->rowmark)(c->display_data, lineno, lineno + 1);
+  showmarks(c, true, lineno, lineno + 1);
+}
+
+/* Tell the display of changes, or save them for later. */
+static void showarea(nonogram_solver *c, const struct nonogram_rect *r)
+{
+  if (c->batcher)
+    nonogram_batcharea(c->batcher, r);
+  else if (c->display && c->display->redrawarea)
+    (*c->display->redrawarea)(c->display_data, r);
+}
+
+static void showmarks(nonogram_solver *c, int rows, size_t from, size_t to)
+{
+  if (c->batcher)
+    nonogram_batchmarks(c->batcher, rows, from, to);
+  else if (c->display && rows && c->display->rowmark)
+    (*c->display->rowmark)(c->display_data, from, to);
+  else if (c->display && !rows && c->display->colmark)
+    (*c->display->colmark)(c->display_data, from, to);
 }
 
-static void gathersolvers(nonogram_solver *c)
+/* Returns -1 if out of memory. */
+static int gathersolvers(nonogram_solver *c, struct nonogram_req *mostp)
 {
   static struct nonogram_req zero;
   struct nonogram_req most = zero, req;
   nonogram_level n;
+  int ok = true;
 
   for (n = 0; n < c->levels; n++)
     if (c->linesolver[n].suite && c->linesolver[n].suite->prep) {
@@ -1107,47 +1907,81 @@ static void gathersolvers(nonogram_solver *c)
         most.cell = req.cell;
     }
 
-  free(c->workspace.byte);
-  free(c->workspace.ptrdiff);
-  free(c->workspace.size);
-  free(c->workspace.nonogram_size);
-  free(c->workspace.cell);
-  c->workspace.byte = malloc(most.byte);
-  c->workspace.ptrdiff = malloc(most.ptrdiff * sizeof(ptrdiff_t));
-  c->workspace.size = malloc(most.size * sizeof(size_t));
-  c->workspace.nonogram_size =
-    malloc(most.nonogram_size * sizeof(nonogram_sizetype));
-  c->workspace.cell = malloc(most.cell * sizeof(nonogram_cell));
+  /* Keep what earlier puzzles needed, if it is enough. */
+#define REGROW(F,T) \
+  do { \
+    if (most.F > c->wsheld.F || !c->workspace.F) { \
+      free(c->workspace.F); \
+      c->workspace.F = malloc(most.F * sizeof(T)); \
+      c->wsheld.F = c->workspace.F ? most.F : 0; \
+      if (!c->workspace.F && most.F) \
+        ok = false; \
+    } \
+  } while (false)
+  REGROW(byte, unsigned char);
+  REGROW(ptrdiff, ptrdiff_t);
+  REGROW(size, size_t);
+  REGROW(nonogram_size, nonogram_sizetype);
+  REGROW(cell, nonogram_cell);
+#undef REGROW
+  *mostp = most;
+  return ok ? 0 : -1;
 }
 
 
 static void redrawrange(nonogram_solver *c, int from, int to);
 static void mark(nonogram_solver *c, int from, int to);
 
+/* Describe a line to a line solver. */
+static void lineargs(nonogram_solver *c, int on_row, size_t lineno,
+                     struct nonogram_initargs *a)
+{
+  if (on_row) {
+    a->line = c->grid + c->puzzle->width * lineno;
+    a->linelen = c->puzzle->width;
+    a->linestep = 1;
+    a->rule = c->puzzle->row[lineno].val;
+    a->rulelen = c->puzzle->row[lineno].len;
+  } else {
+    a->line = c->mirror + c->puzzle->height * lineno;
+    a->linelen = c->puzzle->height;
+    a->linestep = 1;
+    a->rule = c->puzzle->col[lineno].val;
+    a->rulelen = c->puzzle->col[lineno].len;
+  }
+  a->rulestep = 1;
+  a->fits = &c->fits;
+  a->log = &c->tmplog;
+  a->result = c->work;
+  a->resultstep = 1;
+}
+
+/* Start a line solver on a line, with the line's history if the
+   suite can use it. */
+static int initline(const nonogram_solver *c,
+                    const struct nonogram_lsnt *ls, struct nonogram_ws *ws,
+                    int on_row, size_t lineno,
+                    const struct nonogram_initargs *a)
+{
+  struct nonogram_linehist h;
+
+  if (!ls->suite->resume)
+    return (*ls->suite->init)(ls->context, ws, a);
+  h.memo = !c->rowmemo ? NULL :
+    on_row ? c->rowmemo + lineno : c->colmemo + lineno;
+  h.changed = on_row ? c->rowchanged + lineno * c->rowwords :
+    c->colchanged + lineno * c->colwords;
+  return (*ls->suite->resume)(ls->context, ws, a, &h);
+}
+
 static void setupstep(nonogram_solver *c)
 {
   struct nonogram_initargs a;
   const char *name;
 
-  if (c->on_row) {
-    a.line = c->grid + c->puzzle->width * c->lineno;
-    a.linelen = c->puzzle->width;
-    a.linestep = 1;
-    a.rule = c->puzzle->row[c->lineno].val;
-    a.rulelen = c->puzzle->row[c->lineno].len;
-  } else {
-    a.line = c->grid + c->lineno;
-    a.linelen = c->puzzle->height;
-    a.linestep = c->puzzle->width;
-    a.rule = c->puzzle->col[c->lineno].val;
-    a.rulelen = c->puzzle->col[c->lineno].len;
-  }
-  a.rulestep = 1;
-  a.fits = &c->fits;
   c->tmplog = c->log;
-  a.log = &c->tmplog;
-  a.result = c->work;
-  a.resultstep = 1;
+  lineargs(c, c->on_row, c->lineno, &a);
+  c->uncached = false;
 
   c->reversed = false;
 
@@ -1159,6 +1993,9 @@ static void setupstep(nonogram_solver *c)
     name = c->linesolver[c->level - 1].name ?
       c->linesolver[c->level - 1].name : "unknown";
 
+  if (c->trace)
+    traceline(c);
+
 #if nonogram_LOGLEVEL > 0
   if (c->log.file) {
     size_t i;
@@ -1210,9 +2047,26 @@ static void setupstep(nonogram_solver *c)
     return;
   }
 
+  /* perhaps we've solved this line before */
+  if (c->linecache) {
+    if (nonogram_getcachedline(c->linecache,
+                               c->linesolver[c->level - 1].suite,
+                               c->linesolver[c->level - 1].context, &a)) {
+#if nonogram_LOGLEVEL > 0
+      if (c->log.file) {
+        fprintf(c->log.file, "%*s Cached\n", c->log.indent, "");
+        fflush(c->log.file);
+      }
+#endif
+      c->status = nonogram_DONE;
+      return;
+    }
+    c->uncached = true;
+  }
+
   c->status =
-    (*c->linesolver[c->level - 1].suite->init)
-    (c->linesolver[c->level - 1].context, &c->workspace, &a) ?
+    initline(c, &c->linesolver[c->level - 1], &c->workspace,
+             c->on_row, c->lineno, &a) ?
     nonogram_WORKING : nonogram_DONE;
 }
 
@@ -1250,14 +2104,15 @@ static void step(nonogram_solver *c)
 static int redeemstep(nonogram_solver *c)
 {
   int changed = 0;
-  nonogram_cell *line;
+  nonogram_cell *line, *mline;
 #if 0
   nonogram_sizetype *rule;
   size_t rulelen;
   ptrdiff_t rulestep;
 #endif
   size_t linelen, perplen;
-  ptrdiff_t linestep, flagstep;
+  ptrdiff_t linestep, mstep, flagstep;
+  size_t perpbase, lineid;
   nonogram_lineattr *attr, *rattr, *cattr;
   nonogram_level *flag;
 
@@ -1268,6 +2123,15 @@ static int redeemstep(nonogram_solver *c)
     unsigned inrange : 1;
   } cells = { 0, false }, flags = { 0, false };
 
+  /* the same line in the mirror */
+  if (c->on_row) {
+    mline = c->mirror + c->lineno;
+    mstep = c->puzzle->height;
+  } else {
+    mline = c->mirror + c->puzzle->height * c->lineno;
+    mstep = 1;
+  }
+
   if (c->on_row) {
     line = c->grid + c->puzzle->width * c->lineno;
     linelen = c->puzzle->width;
@@ -1282,6 +2146,8 @@ static int redeemstep(nonogram_solver *c)
     cattr = c->rowattr + c->lineno;
     flag = c->colflag;
     flagstep = 1;
+    perpbase = c->puzzle->height;
+    lineid = c->lineno;
   } else {
     line = c->grid + c->lineno;
     linelen = c->puzzle->height;
@@ -1296,8 +2162,17 @@ static int redeemstep(nonogram_solver *c)
     rattr = c->rowattr;
     flag = c->rowflag;
     flagstep = 1;
+    perpbase = 0;
+    lineid = c->puzzle->height + c->lineno;
   }
 
+  /* Decide once per line what needs doing for each cell. */
+  const int trail = c->usetrail && c->stack;
+  const int why = c->learner != NULL;
+  const int redraw = c->batcher || (c->display && c->display->redrawarea);
+  const int marks = c->batcher || (c->display &&
+    (c->on_row ? c->display->colmark : c->display->rowmark));
+
   for (i = 0; i < linelen; i++)
     switch (line[i * linestep]) {
     case nonogram_BLANK:
@@ -1305,11 +2180,27 @@ static int redeemstep(nonogram_solver *c)
       case nonogram_DOT:
       case nonogram_SOLID:
         changed = 1;
-        if (!cells.inrange) {
+        if (redraw && !cells.inrange) {
           cells.from = i;
           cells.inrange = true;
         }
-        line[i * linestep] = c->work[i];
+        if (trail) {
+          if (c->on_row)
+            nonogram_pushtrail(c, i, c->lineno);
+          else
+            nonogram_pushtrail(c, c->lineno, i);
+        }
+        line[i * linestep] = mline[i * mstep] = c->work[i];
+        if (c->on_row)
+          nonogram_touchcell(c, i, c->lineno);
+        else
+          nonogram_touchcell(c, c->lineno, i);
+        if (why) {
+          if (c->on_row)
+            nonogram_because(c, i, c->lineno);
+          else
+            nonogram_because(c, c->lineno, i);
+        }
         c->remcells--;
 
         /* update score for perpendicular line */
@@ -1320,17 +2211,11 @@ static int redeemstep(nonogram_solver *c)
         else
           attr->score++;
 
-        /* update score for solved line */
-        if (!--*(c->work[i] == nonogram_DOT ? &cattr->dot : &cattr->solid))
-          cattr->score = linelen;
-        else
-          cattr->score++;
-
         if (flag[i * flagstep] < c->levels) {
           if (flag[i * flagstep] == 0) c->reminfo++;
           flag[i * flagstep] = c->levels;
 
-          if (!flags.inrange) {
+          if (marks && !flags.inrange) {
             flags.from = i;
             flags.inrange = true;
           }
@@ -1338,6 +2223,14 @@ static int redeemstep(nonogram_solver *c)
           mark(c, flags.from, i);
           flags.inrange = false;
         }
+        nonogram_resched(c, perpbase + i);
+
+        /* update score for solved line */
+        if (!--*(c->work[i] == nonogram_DOT ? &cattr->dot : &cattr->solid))
+          cattr->score = linelen;
+        else
+          cattr->score++;
+        nonogram_resched(c, lineid);
         break;
       }
       break;
@@ -1372,24 +2265,24 @@ static int redeemstep(nonogram_solver *c)
 
 static void mark(nonogram_solver *c, int from, int to)
 {
-  if (c->display) {
+  if (c->batcher || c->display) {
     if (c->on_row) {
-      if (c->display->colmark) {
+      if (c->batcher || c->display->colmark) {
         if (c->reversed) {
           int temp = c->puzzle->height - from;
           from = c->puzzle->height - to;
           to = temp;
         }
-        (*c->display->colmark)(c->display_data, from, to);
+        showmarks(c, false, from, to);
       }
     } else {
-      if (c->display->rowmark) {
+      if (c->batcher || c->display->rowmark) {
         if (c->reversed) {
           int temp = c->puzzle->width - from;
           from = c->puzzle->width - to;
           to = temp;
         }
-        (*c->display->rowmark)(c->display_data, from, to);
+        showmarks(c, true, from, to);
       }
     }
   }
@@ -1397,7 +2290,7 @@ static void mark(nonogram_solver *c, int from, int to)
 
 static void redrawrange(nonogram_solver *c, int from, int to)
 {
-  if (!c->display || !c->display->redrawarea) return;
+  if (!c->batcher && (!c->display || !c->display->redrawarea)) return;
 
   if (c->on_row) {
     if (c->reversed) {
@@ -1416,128 +2309,7 @@ static void redrawrange(nonogram_solver *c, int from, int to)
       c->editarea.max.y = to;
     }
   }
-  (*c->display->redrawarea)(c->display_data, &c->editarea);
-}
-
-/* Find the best cell to make a guess at, and specify what that guess
-   should be. */
-static void chooseguess(nonogram_solver *restrict c,
-                        const struct nonogram_rect *restrict from,
-                        struct nonogram_point *restrict pos,
-                        nonogram_cell *restrict choice)
-{
-  size_t x, y;
-#if 1
-  for (x = from->min.x; x < from->max.x; x++)
-    for (y = from->min.y; y < from->max.y; y++)
-      if (c->grid[x + y * c->puzzle->width] == nonogram_BLANK)
-        goto found;
-  assert(false);
- found:
-  pos->x = x;
-  pos->y = y;
-#else
-  {
-    int bestscore = INT_MIN;
-    assert(bestscore <= (int) -(c->puzzle->width + c->puzzle->height));
-
-    for (x = from->min.x; x < from->max.x; x++) {
-      int unknown_in_col = c->colattr[x].dot + c->colattr[x].solid;
-      for (y = from->min.y; y < from->max.y; y++) {
-        if (c->grid[x + y * c->puzzle->width] != nonogram_BLANK)
-          continue;
-
-        int score = 0;
-
-#if 1
-        /* Use the heuristic line scores. */
-        score += c->rowattr[y].score + c->colattr[x].score;
-#endif
-
-#if 0
-        /* Add a constant to prevent negative numbers.  It's
-           probably not worth using this, as it is just more work
-           with no extra descrimination.  */
-        score += c->puzzle->width + c->puzzle->height;
-#endif
-
-#if 0
-        /* Favour lines with a high imbalance of unknown dots and
-           solids. */
-
-        score += 100 * c->rowattr[y].dot / c->rowattr[y].solid;
-        score += 100 * c->rowattr[y].solid / c->rowattr[y].dot;
-
-        score += 100 * c->colattr[x].dot / c->colattr[x].solid;
-        score += 100 * c->colattr[x].solid / c->colattr[x].dot;
-#endif
-
-#if 0
-        /* Favour cells with a high imbalance of unknown dots and
-           solids. */
-
-        score += 100 * (c->colattr[x].dot + c->rowattr[y].dot)
-          / (c->rowattr[y].solid + c->colattr[x].solid);
-        score += 100 * (c->rowattr[y].solid + c->colattr[x].solid)
-          / (c->rowattr[y].dot + c->colattr[x].dot);
-#endif
-
-#if 1
-        /* Ignore a line's unknown count if its perpendicular has
-           a smaller unknown count. */
-        int unknown_in_row = c->rowattr[y].dot + c->rowattr[y].solid;
-        if (unknown_in_row < unknown_in_col)
-          score -= unknown_in_row;
-        else
-          score -= unknown_in_col;
-#endif
-
-#if 0
-        /* Favour cells that are in a 'corner'. */
-        if (x == 0 ||
-            c->grid[(x - 1) + y * c->puzzle->width]
-            != nonogram_BLANK)
-          score += c->puzzle->width;
-        if (x + 1 == c->puzzle->width ||
-            c->grid[(x + 1) + y * c->puzzle->width]
-            != nonogram_BLANK)
-          score += c->puzzle->width;
-        if (y == 0 ||
-            c->grid[x + (y - 1) * c->puzzle->width]
-            != nonogram_BLANK)
-          score += c->puzzle->height;
-        if (y + 1 == c->puzzle->height ||
-            c->grid[x + (y + 1) * c->puzzle->width]
-            != nonogram_BLANK)
-          score += c->puzzle->height;
-#endif
-
-#if 0
-        /* Favour lines with fewer unknowns. */
-        score -= c->colattr[x].dot;
-        score -= c->rowattr[y].dot;
-        score -= c->colattr[x].solid;
-        score -= c->rowattr[y].solid;
-#endif
-
-
-
-        if (score <= bestscore)
-          continue;
-        bestscore = score;
-        pos->x = x;
-        pos->y = y;
-      }
-    }
-  }
-#endif
-
-  /* Choose the colour based on what's left in the row and column. */
-  if (c->colattr[pos->x].dot + c->rowattr[pos->y].dot >
-      c->colattr[pos->x].solid + c->rowattr[pos->y].solid)
-    *choice = nonogram_DOT;
-  else
-    *choice = nonogram_SOLID;
+  showarea(c, &c->editarea);
 }
 
 const char *const nonogram_date = __DATE__;
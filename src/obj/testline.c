@@ -350,6 +350,8 @@ static struct solver solvers[] = {
   { .name = "complete", .ops = &nonogram_completesuite },
   { .name = "fast", .ops = &nonogram_fastsuite },
   { .name = "fcomp", .ops = &nonogram_fcompsuite },
+  { .name = "bits", .ops = &nonogram_bitsuite },
+  { .name = "dp", .ops = &nonogram_dpsuite },
 };
 
 #define SOLVERS (sizeof solvers / sizeof solvers[0])
@@ -0,0 +1,315 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* A ring of events, written by one thread without locks.  'claimed'
+   counts events that have been started, and 'head' those that have
+   been finished.  A reader copies what lies before 'head', then
+   discards anything that a write claimed since might have
+   overwritten.  Each event is held as words that are stored and
+   loaded atomically, so such a copy is discarded rather than racy. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+/* Readers can only be sure what they read is intact with C11
+   atomics.  Without them, only read when the solver isn't running. */
+#ifndef nonogram_ATOMICS
+#if __STDC_VERSION__ >= 201112L && !defined __STDC_NO_ATOMICS__
+#define nonogram_ATOMICS 1
+#else
+#define nonogram_ATOMICS 0
+#endif
+#endif
+
+#if nonogram_ATOMICS
+#include <stdatomic.h>
+typedef atomic_ullong counter;
+typedef atomic_ulong word;
+#define load(P,O) atomic_load_explicit((P), memory_order_##O)
+#define store(P,V,O) atomic_store_explicit((P), (V), memory_order_##O)
+#define fence(O) atomic_thread_fence(memory_order_##O)
+#else
+typedef unsigned long long counter;
+typedef unsigned long word;
+#define load(P,O) (*(P))
+#define store(P,V,O) ((void) (*(P) = (V)))
+#define fence(O) ((void) 0)
+#endif
+
+/* 'kind' holds 'type', 'flags' and 'level' of struct nonogram_event
+   in its low 32 bits. */
+struct slot {
+  counter when;
+  word kind, a, b, c;
+};
+
+struct nonogram_trace {
+  counter claimed, head;
+  size_t mask;
+  int timed;
+  struct slot *ev;
+};
+
+nonogram_trace *nonogram_maketrace(size_t records, int timed)
+{
+  size_t size = 1;
+  while (size < records)
+    size <<= 1;
+
+  nonogram_trace *t = malloc(sizeof *t);
+  if (!t) return NULL;
+  t->ev = malloc(size * sizeof *t->ev);
+  if (!t->ev) {
+    free(t);
+    return NULL;
+  }
+  t->mask = size - 1;
+  t->timed = timed;
+  store(&t->claimed, 0, relaxed);
+  store(&t->head, 0, relaxed);
+  return t;
+}
+
+void nonogram_freetrace(nonogram_trace *t)
+{
+  if (!t) return;
+  free(t->ev);
+  free(t);
+}
+
+void nonogram_tracepoint(nonogram_trace *t, int type, int flags,
+                         unsigned level, unsigned long a,
+                         unsigned long b, unsigned long c)
+{
+  const unsigned long long n = load(&t->head, relaxed);
+
+  /* Warn readers before touching the slot. */
+  store(&t->claimed, n + 1, relaxed);
+  fence(release);
+
+  struct slot *e = &t->ev[n & t->mask];
+  store(&e->when, t->timed ? nonogram_monotime() : 0, relaxed);
+  store(&e->kind, (type & 0xfful) | (flags & 0xfful) << 8 |
+        (level & 0xfffful) << 16, relaxed);
+  store(&e->a, a, relaxed);
+  store(&e->b, b, relaxed);
+  store(&e->c, c, relaxed);
+
+  store(&t->head, n + 1, release);
+}
+
+size_t nonogram_readtrace(const nonogram_trace *t,
+                          struct nonogram_event *to, size_t max)
+{
+  nonogram_trace *mt = (nonogram_trace *) t;
+  const unsigned long long head = load(&mt->head, acquire);
+  const unsigned long long size = t->mask + 1;
+  unsigned long long from = head > size ? head - size : 0;
+  if (head - from > max)
+    from = head - max;
+
+  for (unsigned long long n = from; n < head; n++) {
+    struct slot *e = &mt->ev[n & t->mask];
+    struct nonogram_event *d = &to[n - from];
+    d->when = load(&e->when, relaxed);
+    const unsigned long kind = load(&e->kind, relaxed);
+    d->type = kind & 0xffu;
+    d->flags = (kind >> 8) & 0xffu;
+    d->level = (kind >> 16) & 0xffffu;
+    d->a = load(&e->a, relaxed);
+    d->b = load(&e->b, relaxed);
+    d->c = load(&e->c, relaxed);
+  }
+
+  /* Drop those that might have been overwritten while copying. */
+  fence(acquire);
+  const unsigned long long claimed = load(&mt->claimed, relaxed);
+  unsigned long long lost = claimed > size ? claimed - size : 0;
+  if (lost <= from)
+    return head - from;
+  if (lost >= head)
+    return 0;
+  memmove(to, to + (lost - from), (head - lost) * sizeof *to);
+  return head - lost;
+}
+
+/* Each event is dumped as 'when' in 8 bytes, then 'type', 'flags',
+   'level' in 2 bytes, and 'a', 'b' and 'c' in 4 bytes each, all
+   least significant byte first. */
+#define MAGIC "NONOTRC1"
+#define RECSIZE 24
+
+static unsigned char *putnum(unsigned char *p, unsigned long long v,
+                             int bytes)
+{
+  while (bytes-- > 0)
+    *p++ = v & 0xffu, v >>= 8;
+  return p;
+}
+
+static unsigned long long getnum(const unsigned char **pp, int bytes)
+{
+  const unsigned char *p = *pp;
+  unsigned long long v = 0;
+  for (int i = bytes; i-- > 0; )
+    v = (v << 8) | p[i];
+  *pp = p + bytes;
+  return v;
+}
+
+int nonogram_dumptrace(const nonogram_trace *t, FILE *fp)
+{
+  struct nonogram_event *ev = malloc((t->mask + 1) * sizeof *ev);
+  if (!ev) return -1;
+  const size_t n = nonogram_readtrace(t, ev, t->mask + 1);
+
+  int rc = fwrite(MAGIC, 1, sizeof MAGIC - 1, fp) == sizeof MAGIC - 1 ?
+    0 : -1;
+  for (size_t i = 0; rc == 0 && i < n; i++) {
+    unsigned char rec[RECSIZE], *p = rec;
+    p = putnum(p, ev[i].when, 8);
+    p = putnum(p, ev[i].type, 1);
+    p = putnum(p, ev[i].flags, 1);
+    p = putnum(p, ev[i].level, 2);
+    p = putnum(p, ev[i].a, 4);
+    p = putnum(p, ev[i].b, 4);
+    p = putnum(p, ev[i].c, 4);
+    if (fwrite(rec, 1, RECSIZE, fp) != RECSIZE)
+      rc = -1;
+  }
+  free(ev);
+  return rc;
+}
+
+/* Scores can be negative. */
+static long sign32(unsigned long v)
+{
+  v &= 0xfffffffful;
+  return v & 0x80000000ul ? -(long) (0xfffffffful - v) - 1 : (long) v;
+}
+
+static int cellchar(int flags)
+{
+  switch (flags & nonogram_BOTH) {
+  case nonogram_DOT:
+    return '-';
+  case nonogram_SOLID:
+    return '#';
+  default:
+    return '?';
+  }
+}
+
+int nonogram_decodetrace(FILE *in, FILE *out)
+{
+  char magic[sizeof MAGIC - 1];
+  if (fread(magic, 1, sizeof magic, in) != sizeof magic ||
+      memcmp(magic, MAGIC, sizeof magic))
+    return -1;
+
+  unsigned char rec[RECSIZE];
+  unsigned long long start = 0;
+  int indent = 0;
+  size_t got;
+  while ((got = fread(rec, 1, RECSIZE, in)) == RECSIZE) {
+    const unsigned char *p = rec;
+    struct nonogram_event e;
+    e.when = getnum(&p, 8);
+    e.type = getnum(&p, 1);
+    e.flags = getnum(&p, 1);
+    e.level = getnum(&p, 2);
+    e.a = getnum(&p, 4);
+    e.b = getnum(&p, 4);
+    e.c = getnum(&p, 4);
+
+    /* Closing braces come before the time. */
+    if (e.type == nonogram_EVEND || e.type == nonogram_EVCONFLICT ||
+        e.type == nonogram_EVPOP)
+      if (indent >= 2)
+        indent -= 2;
+
+    if (e.when) {
+      if (!start)
+        start = e.when;
+      fprintf(out, "%12.6f ", (e.when - start) / 1e6);
+    }
+
+    const char *const line = e.flags & nonogram_EVROW ? "Row" : "Column";
+    switch (e.type) {
+    case nonogram_EVLINE:
+      fprintf(out, "%*s%s %lu [%ld]: level %u {\n", indent, "",
+              line, e.a, sign32(e.b), (unsigned) e.level);
+      indent += 2;
+      break;
+
+    case nonogram_EVEND:
+      fprintf(out, "%*s} %s %lu: %lu changed; Cells: %lu\n", indent, "",
+              line, e.a, e.b, e.c);
+      break;
+
+    case nonogram_EVCONFLICT:
+      fprintf(out, "%*s} %s %lu: Inconsistency!\n", indent, "",
+              line, e.a);
+      break;
+
+    case nonogram_EVGUESS:
+      fprintf(out, "%*sGuessing %c at (%lu,%lu)\n", indent, "",
+              cellchar(e.flags), e.a, e.b);
+      break;
+
+    case nonogram_EVPUSH:
+      fprintf(out, "%*sPushing guess at (%lu,%lu) [%u] {\n", indent, "",
+              e.a, e.b, (unsigned) e.level);
+      indent += 2;
+      break;
+
+    case nonogram_EVFLIP:
+      fprintf(out, "%*sFlipped guess %c at (%lu,%lu)\n", indent, "",
+              cellchar(e.flags), e.a, e.b);
+      break;
+
+    case nonogram_EVPOP:
+      fprintf(out, "%*s} Restoring guess at (%lu,%lu) [%u]; Cells: %lu\n",
+              indent, "", e.a, e.b, (unsigned) e.level, e.c);
+      break;
+
+    case nonogram_EVFIX:
+      fprintf(out, "%*sFixed %c at (%lu,%lu)\n", indent, "",
+              cellchar(e.flags), e.a, e.b);
+      break;
+
+    case nonogram_EVFOUND:
+      fprintf(out, "%*sCorrect grid.\n", indent, "");
+      break;
+
+    default:
+      fprintf(out, "%*sUnknown event %u\n", indent, "", (unsigned) e.type);
+      break;
+    }
+  }
+  return got == 0 && !ferror(in) ? 0 : -1;
+}
@@ -0,0 +1,75 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* With a trail, back-tracking costs as much as the cells set since
+   the guess, rather than the whole unknown area.  Space is reserved
+   by the solver before each guess, so recording never fails. */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+void nonogram_pushtrail(nonogram_solver *c, size_t x, size_t y)
+{
+  assert(c->traillen < c->trailcap);
+  struct nonogram_trailent *e = &c->trail[c->traillen++];
+  e->cell = x + y * c->puzzle->width;
+  e->old = c->grid[e->cell];
+  e->row = c->rowattr[y];
+  e->col = c->colattr[x];
+}
+
+void nonogram_undotrail(nonogram_solver *c, size_t mark)
+{
+  const size_t width = c->puzzle->width, height = c->puzzle->height;
+
+  while (c->traillen > mark) {
+    const struct nonogram_trailent *e = &c->trail[--c->traillen];
+    const size_t x = e->cell % width, y = e->cell / width;
+    c->grid[e->cell] = c->mirror[y + x * height] = e->old;
+    nonogram_touchcell(c, x, y);
+    c->rowattr[y] = e->row;
+    c->colattr[x] = e->col;
+  }
+}
+
+/* Until the next guess, no more cells can be set than remain unknown,
+   plus the guess itself, and its flip. */
+int nonogram_reservetrail(nonogram_solver *c)
+{
+  size_t need = c->traillen + (size_t) c->remcells + 2;
+  if (need <= c->trailcap)
+    return 0;
+
+  size_t cap = c->trailcap ? c->trailcap : 64;
+  while (cap < need)
+    cap *= 2;
+  struct nonogram_trailent *tmp = realloc(c->trail, cap * sizeof *tmp);
+  if (!tmp)
+    return -1;
+  c->trail = tmp;
+  c->trailcap = cap;
+  return 0;
+}
@@ -0,0 +1,86 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  Nonolib - Nonogram-solver library
+ *  Copyright (C) 2001,2005-8,2012  Steven Simpson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <string.h>
+
+#include "nonogram.h"
+#include "internal.h"
+
+struct unique {
+  const nonogram_solver *c;
+  nonogram_cell *first;
+  int count;
+};
+
+static void present(void *ctxt)
+{
+  struct unique *u = ctxt;
+  if (u->count++ == 0 && u->first)
+    memcpy(u->first, u->c->grid,
+           u->c->puzzle->width * u->c->puzzle->height);
+}
+
+static int always(void *ctxt)
+{
+  UNUSED(ctxt);
+  return true;
+}
+
+int nonogram_checkunique(nonogram_solver *c, const nonogram_puzzle *puzzle,
+                         nonogram_cell *grid, int remcells,
+                         nonogram_cell *first)
+{
+  static const struct nonogram_client client = { &present };
+  struct unique u = { c, first, 0 };
+  int rc;
+
+  /* Stand in for the user's client, display and log until done. */
+  const struct nonogram_client *oldclient = c->client;
+  void *oldclient_data = c->client_data;
+  const struct nonogram_display *olddisplay = c->display;
+  FILE *oldlog = c->log.file;
+
+  if (c->puzzle)
+    return -1;
+  c->client = &client;
+  c->client_data = &u;
+  c->display = NULL;
+  c->log.file = NULL;
+
+  if (nonogram_load(c, puzzle, grid, remcells) < 0) {
+    u.count = -1;
+  } else {
+    do
+      rc = nonogram_runcycles(c, &always, NULL);
+    while (u.count < 2 && rc != nonogram_FINISHED && rc != nonogram_ERROR);
+    if (rc == nonogram_ERROR)
+      u.count = -1;
+    nonogram_unload(c);
+  }
+
+  c->client = oldclient;
+  c->client_data = oldclient_data;
+  c->display = olddisplay;
+  c->log.file = oldlog;
+  return u.count;
+}